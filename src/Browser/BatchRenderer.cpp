@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "BatchRenderer.h"
+
+#include "Browser.h"
+#include "OffscreenBuffer.h"
+#include "RenderThread.h"
+#include "Tab.h"
+#include <GL/gl.h>
+#include <algorithm>
+#include <cairo.h>
+#include <cstdio>
+#include <iostream>
+
+#include "FatalError.h"
+
+// Pages still loading after this are rendered as they are.
+static const guint loadTimeout = 30000;
+// Loads are checked against loadTimeout this often, a job can overrun it by up to this much.
+static const guint loadTimeoutCheckInterval = loadTimeout / 10;
+// How long to wait for a page to produce a frame after it's made visible.
+static const guint firstFrameTimeout = 2000;
+
+BatchRenderer::BatchRenderer(Browser* browser, const std::vector<std::string>& urls, const std::string& outputDirectory, int jobs, int frames)
+    : m_browser(browser)
+    , m_urls(urls)
+    , m_outputDirectory(outputDirectory)
+    , m_jobs(std::max(jobs, 1))
+    , m_frames(std::max(frames, 1))
+    , m_nextUrl(0)
+    , m_isRendering(false)
+    , m_loadTimer(0)
+    , m_renderTimer(0)
+{
+    if (g_mkdir_with_parents(m_outputDirectory.c_str(), 0755))
+        throw FatalError("Can't create batch output directory " + m_outputDirectory);
+
+    const std::string resultsPath = m_outputDirectory + "/results.csv";
+    m_results.open(resultsPath.c_str());
+    if (!m_results)
+        throw FatalError("Can't write " + resultsPath);
+    m_results << "index,url,status,load_ms,frames,paint_avg_ms,paint_max_ms,snapshot" << std::endl;
+}
+
+BatchRenderer::~BatchRenderer()
+{
+    if (m_loadTimer)
+        g_source_remove(m_loadTimer);
+    if (m_renderTimer)
+        g_source_remove(m_renderTimer);
+}
+
+void BatchRenderer::start()
+{
+    // The UI may be reloaded, but the batch only runs once.
+    if (m_nextUrl)
+        return;
+    if (m_urls.empty()) {
+        m_browser->onWindowClose();
+        return;
+    }
+    startLoads();
+    m_loadTimer = g_timeout_add(loadTimeoutCheckInterval, loadTimeoutCallback, this);
+}
+
+void BatchRenderer::startLoads()
+{
+    while (m_nextUrl < m_urls.size() && m_loading.size() + m_loaded.size() + m_isRendering < size_t(m_jobs)) {
+        Job job;
+        job.index = m_nextUrl;
+        job.url = m_urls[m_nextUrl++];
+        job.loadStart = g_get_monotonic_time();
+        job.loadEnd = 0;
+        job.timedOut = false;
+        job.tab = m_browser->requestTabForUrl(job.url);
+        m_loading.push_back(job);
+    }
+}
+
+gboolean BatchRenderer::loadTimeoutCallback(gpointer data)
+{
+    // Polled instead of having a timer per job, a few seconds of precision are enough here.
+    BatchRenderer* self = reinterpret_cast<BatchRenderer*>(data);
+    int64_t now = g_get_monotonic_time();
+    std::vector<Tab*> timedOut;
+    for (Job& job : self->m_loading) {
+        if (now - job.loadStart >= int64_t(loadTimeout) * 1000) {
+            std::cerr << "Timeout loading " << job.url << std::endl;
+            job.timedOut = true;
+            timedOut.push_back(job.tab);
+        }
+    }
+    for (Tab* tab : timedOut)
+        self->tabLoadFinished(tab);
+    return true;
+}
+
+void BatchRenderer::tabLoadFinished(Tab* tab)
+{
+    auto it = std::find_if(m_loading.begin(), m_loading.end(), [tab](const Job& job) { return job.tab == tab; });
+    if (it == m_loading.end())
+        return;
+
+    Job job = *it;
+    job.loadEnd = g_get_monotonic_time();
+    m_loading.erase(it);
+    m_loaded.push_back(job);
+    renderNext();
+}
+
+void BatchRenderer::renderNext()
+{
+    if (m_isRendering || m_loaded.empty())
+        return;
+
+    m_rendering = m_loaded.front();
+    m_loaded.pop_front();
+    m_isRendering = true;
+
+    // Hidden tabs don't paint, wait for the page to produce a frame before rendering it.
+    m_rendering.tab->setVisibility(kWKPageVisibilityStateVisible);
+    scheduleRender(firstFrameTimeout);
+}
+
+void BatchRenderer::scheduleRender(guint delay)
+{
+    if (m_renderTimer)
+        g_source_remove(m_renderTimer);
+    m_renderTimer = g_timeout_add(delay, renderCallback, this);
+}
+
+gboolean BatchRenderer::renderCallback(gpointer data)
+{
+    BatchRenderer* self = reinterpret_cast<BatchRenderer*>(data);
+    self->m_renderTimer = 0;
+    self->render();
+    return false;
+}
+
+void BatchRenderer::tabNeedsDisplay(Tab* tab)
+{
+    // Rendering closes the tab, so it can't happen from inside its callbacks.
+    if (m_isRendering && m_rendering.tab == tab)
+        scheduleRender(0);
+}
+
+void BatchRenderer::render()
+{
+    if (!m_isRendering)
+        return;
+
+    Job job = m_rendering;
+    m_isRendering = false;
+
+    // The UI may have hidden the tab meanwhile.
+    job.tab->setVisibility(kWKPageVisibilityStateVisible);
+
+    WKSize windowSize = m_browser->window()->size();
+    WKSize contentsSize = m_browser->contentsSize();
+    std::vector<int64_t> paintTimes;
+    std::string snapshot;
+    // Nothing else goes on in batch mode, so just wait for the render thread.
+    m_browser->renderThread()->sync([this, &job, windowSize, contentsSize, &paintTimes, &snapshot] {
+        renderSnapshot(job, windowSize, contentsSize, &paintTimes, &snapshot);
+    });
+
+    writeResult(job, paintTimes, snapshot);
+    finishJob(job);
+}
+
+void BatchRenderer::renderSnapshot(const Job& job, const WKSize& windowSize, const WKSize& contentsSize, std::vector<int64_t>* paintTimes, std::string* snapshot)
+{
+    OffscreenBuffer buffer;
+    if (buffer.resize(windowSize)) {
+        // Each paint is waited for, so the times include the GPU work.
+        buffer.bind();
+        glViewport(0, 0, windowSize.width, windowSize.height);
+        for (int i = 0; i < m_frames; ++i) {
+            int64_t start = g_get_monotonic_time();
+            glClearColor(1.0, 1.0, 1.0, 1.0);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+            WKViewPaintToCurrentGLContext(job.tab->webView());
+            glFinish();
+            paintTimes->push_back(g_get_monotonic_time() - start);
+        }
+        buffer.release();
+
+        char fileName[32];
+        snprintf(fileName, sizeof(fileName), "%04zu.png", job.index);
+        cairo_surface_t* image = buffer.toImage(WKRectMake(0, windowSize.height - contentsSize.height, contentsSize.width, contentsSize.height));
+        if (cairo_surface_write_to_png(image, (m_outputDirectory + "/" + fileName).c_str()) == CAIRO_STATUS_SUCCESS)
+            *snapshot = fileName;
+        else
+            std::cerr << "Can't write snapshot of " << job.url << std::endl;
+        cairo_surface_destroy(image);
+    } else
+        std::cerr << "Offscreen rendering not supported, can't render " << job.url << std::endl;
+}
+
+void BatchRenderer::writeResult(const Job& job, const std::vector<int64_t>& paintTimes, const std::string& snapshot)
+{
+    int64_t total = 0;
+    int64_t maximum = 0;
+    for (int64_t time : paintTimes) {
+        total += time;
+        maximum = std::max(maximum, time);
+    }
+    double average = paintTimes.empty() ? 0 : double(total) / paintTimes.size();
+
+    // URLs may have commas and quotes.
+    std::string url;
+    for (char c : job.url)
+        url += c == '"' ? std::string("\"\"") : std::string(1, c);
+
+    m_results << job.index << ",\"" << url << "\"," << (job.timedOut ? "timeout" : "ok") << ','
+        << (job.loadEnd - job.loadStart) / 1000.0 << ',' << paintTimes.size() << ','
+        << average / 1000.0 << ',' << maximum / 1000.0 << ',' << snapshot << std::endl;
+}
+
+void BatchRenderer::finishJob(const Job& job)
+{
+    std::cout << "Rendered " << job.url << " (" << job.index + 1 << "/" << m_urls.size() << ")" << std::endl;
+
+    // Start the next loads before closing the tab, the browser quits when the last tab is closed.
+    startLoads();
+    m_browser->closeTab(job.tab->id());
+    renderNext();
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BatchRenderer_h
+#define BatchRenderer_h
+
+#include <deque>
+#include <fstream>
+#include <glib.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <WebKit2/WKGeometry.h>
+
+class Browser;
+class Tab;
+
+// Non interactive mode: loads a list of URLs, jobs of them at a time, and once each page finishes
+// loading paints it a fixed number of times offscreen, saving a PNG snapshot and a CSV row with the
+// load and paint timings. The browser quits when all URLs are done.
+class BatchRenderer
+{
+public:
+    BatchRenderer(Browser*, const std::vector<std::string>& urls, const std::string& outputDirectory, int jobs, int frames);
+    ~BatchRenderer();
+
+    void start();
+
+    void tabLoadFinished(Tab*);
+    void tabNeedsDisplay(Tab*);
+
+private:
+    struct Job {
+        size_t index;
+        std::string url;
+        Tab* tab;
+        int64_t loadStart;
+        int64_t loadEnd;
+        bool timedOut;
+    };
+
+    Browser* m_browser;
+    std::vector<std::string> m_urls;
+    std::string m_outputDirectory;
+    int m_jobs;
+    int m_frames;
+    std::ofstream m_results;
+
+    size_t m_nextUrl;
+    std::vector<Job> m_loading;
+    std::deque<Job> m_loaded;
+    // The job waiting for its first frame after being made visible.
+    Job m_rendering;
+    bool m_isRendering;
+    guint m_loadTimer;
+    guint m_renderTimer;
+
+    void startLoads();
+    void renderNext();
+    void scheduleRender(guint delay);
+    void render();
+    void renderSnapshot(const Job&, const WKSize& windowSize, const WKSize& contentsSize, std::vector<int64_t>* paintTimes, std::string* snapshot);
+    void finishJob(const Job&);
+    void writeResult(const Job&, const std::vector<int64_t>& paintTimes, const std::string& snapshot);
+
+    static gboolean loadTimeoutCallback(gpointer);
+    static gboolean renderCallback(gpointer);
+};
+
+#endif
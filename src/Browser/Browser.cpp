@@ -36,46 +36,155 @@
 #include <GL/gl.h>
 #include <cairo.h>
 #include <glib.h>
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
 #include <cstring>
 #include <unistd.h>
 #include <cstdlib>
+#include <iostream>
 #include <libgen.h>
 #include <limits.h>
 #include <string>
 #include <vector>
 
+#include "BatchRenderer.h"
+#include "ContextPool.h"
 #include "FatalError.h"
+#include "FrameTimings.h"
 #include "InjectedBundleGlue.h"
+#include "NativeChrome.h"
+#include "OffscreenBuffer.h"
+#include "PerformanceHud.h"
+#include "ProcessGroups.h"
+#include "RenderThread.h"
+#include "SessionJournal.h"
+#include "StartupTrace.h"
+#include "UiResources.h"
 #include "Tab.h"
+#include "TabThumbnailCache.h"
+#include "WebChrome.h"
 
-Browser::Browser(const std::vector<std::string>& urls)
-    : m_displayUpdateScheduled(false)
-    , m_window(DesktopWindow::create(this, 1024, 600))
+static DesktopWindow* createWindow(DesktopWindowClient* client, const BrowserOptions& options)
+{
+    const int width = 1024;
+    const int height = 600;
+    if (options.headless)
+        return DesktopWindow::createHeadless(client, width, height, options.inputScript);
+    return DesktopWindow::create(client, width, height, options.kiosk);
+}
+
+// Seconds after which the startup summary is written with the milestones reached so far.
+static const guint startupTraceTimeout = 30;
+
+Browser::Browser(const BrowserOptions& options)
+    : m_options(options)
+    , m_window(createWindow(this, options))
+    , m_frameClock(new FrameClock(m_window, this))
+    , m_renderThread(new RenderThread(m_window))
+    , m_frameInFlight(false)
+    , m_captureQueued(false)
     , m_glue(0)
+    , m_contentsGlue(0)
+    , m_powerMonitor(this, options.idleTimeout)
+    // Batch mode renders tabs in the background, they can't go away.
+    , m_memoryMonitor(this, options.batchOutputDirectory.empty() ? options.tabDiscardThreshold : 0)
+    , m_resourceMonitor(this, options.resourceLogFile)
+    , m_processGroups(options.backgroundCpuPercent && options.batchOutputDirectory.empty() ? new ProcessGroups(options.cgroup, options.backgroundCpuPercent) : 0)
+    , m_loadScheduler(options.maxLoads)
+    , m_hangMonitor(this, options.hangTimeout, &m_resourceMonitor)
+    , m_uiBuffer(new OffscreenBuffer)
+    , m_batchRenderer(0)
+    , m_thumbnails(options.thumbnailCacheMegabytes ? new TabThumbnailCache(size_t(options.thumbnailCacheMegabytes) * 1024 * 1024) : 0)
+    , m_thumbnailCaptureBuffer(new OffscreenBuffer)
+    , m_lastFrame(new OffscreenBuffer(OffscreenBuffer::ColorOnly))
+    , m_lastFrameToolBarHeight(0)
+    , m_lastFrameStale(true)
+    , m_placeholder(NoPlaceholder)
+    , m_placeholderTimeout(0)
+    , m_layoutPending(false)
+    , m_frameTimings(new FrameTimings)
+    , m_performanceHud(options.showPerformanceHud ? new PerformanceHud : 0)
+    , m_lastFrameStart(0)
+    , m_startupTraced(false)
+    , m_chrome(0)
+    , m_nativeChrome(0)
+    , m_uiView(0)
+    , m_uiPage(0)
+    , m_uiContext(0)
+    , m_uiPageGroup(0)
+    , m_uiCrashBackoff(0)
+    , m_uiReady(false)
     , m_uiFocused(true)
+    , m_windowVisible(true)
     , m_toolBarHeight(0)
+    , m_contextPool(0)
+    , m_spareTab(0)
+    , m_spareTabSource(0)
+    , m_session(0)
+    , m_sessionTrickleTimer(0)
     , m_currentTab(-1)
-    , m_initialUrls(urls)
 {
     m_mainLoop = g_main_loop_new(0, false);
+    m_frameClock->setMaxFramesPerSecond(m_options.maxFramesPerSecond);
+    if (!m_options.batchOutputDirectory.empty())
+        m_batchRenderer = new BatchRenderer(this, m_options.urls, m_options.batchOutputDirectory, m_options.batchJobs, m_options.batchFrames);
+    // There's only one tab to restore in kiosk mode, the one on the command line.
+    else if (!m_options.sessionFile.empty() && !m_options.kiosk)
+        m_session = new SessionJournal(m_options.sessionFile);
 
     initUi();
+
+    // Without a URL, or if the first load fails, the page milestones are never reached.
+    g_timeout_add_seconds(startupTraceTimeout, [](gpointer data) -> gboolean {
+        static_cast<Browser*>(data)->finishStartupTrace();
+        return false;
+    }, this);
 }
 
 Browser::~Browser()
 {
+    // Quit before the startup finished or the timeout expired.
+    finishStartupTrace();
+    delete m_batchRenderer;
+    clearPlaceholder();
+    // Finishes the last frame and makes the window context current here again.
+    delete m_renderThread;
+    while (g_source_remove_by_user_data(this)) { }
+
     for (std::pair<const int, Tab*> p : m_tabs)
         delete p.second;
     m_tabs.clear();
+    delete m_spareTab;
+    delete m_session;
+    std::cout << m_contextPool->stats() << std::endl;
+    delete m_contextPool;
+    // After the contexts, which terminate the web processes in the cgroups.
+    delete m_processGroups;
     WKRelease(m_contentPageGroup);
 
     g_main_loop_unref(m_mainLoop);
-    WKRelease(m_uiView);
-    WKRelease(m_uiContext);
+    if (m_uiView) {
+        WKRelease(m_uiView);
+        WKRelease(m_uiContext);
+    }
+    delete m_chrome;
+    if (!m_options.frameTimingsFile.empty() && !m_frameTimings->writeToFile(m_options.frameTimingsFile))
+        std::cerr << "Can't write frame timings to " << m_options.frameTimingsFile << std::endl;
+    if (!m_options.powerStatsFile.empty() && !m_powerMonitor.writeToFile(m_options.powerStatsFile))
+        std::cerr << "Can't write power stats to " << m_options.powerStatsFile << std::endl;
+    delete m_frameTimings;
+
+    m_window->makeCurrent();
+    delete m_performanceHud;
+    delete m_thumbnails;
+    delete m_thumbnailCaptureBuffer;
+    delete m_lastFrame;
+    delete m_uiBuffer;
+    delete m_frameClock;
     delete m_window;
     delete m_glue;
+    delete m_contentsGlue;
 }
 
 std::string getApplicationPath()
@@ -95,6 +204,7 @@ std::string getApplicationPath()
     }
 }
 
+#if !defined(EMBED_UI_RESOURCES)
 static std::string getUiFile()
 {
     std::vector<std::string> locations = {
@@ -112,8 +222,46 @@ static std::string getUiFile()
     }
     throw FatalError("Can't find UI files.");
 }
+#endif
 
 void Browser::initUi()
+{
+    // The kiosk toolbar height stays 0.
+    if (m_options.kiosk)
+        m_chrome = new Chrome;
+    else if (m_options.nativeChrome) {
+        m_nativeChrome = new NativeChrome(this);
+        m_chrome = m_nativeChrome;
+        toolBarHeightChanged(m_nativeChrome->height());
+    } else {
+        m_chrome = new WebChrome(this);
+        initUiView();
+    }
+
+    // There's no UI page to call it once loaded. Tabs need the contents context set up below.
+    if (!m_uiView) {
+        StartupTrace::mark(StartupTrace::UiLoadStarted);
+        g_idle_add([](gpointer data) -> gboolean {
+            static_cast<Browser*>(data)->didUiReady();
+            return false;
+        }, this);
+    }
+
+    m_contentsGlue = new InjectedBundleGlue;
+    m_contentsGlue->bind("gamepadActivity", this, &Browser::gamepadActivity);
+    m_contentsGlue->bind("pong", this, &Browser::tabPong);
+    // FIXME Find a good way to find where the injected bundle is
+    m_contextPool = new ContextPool(getApplicationPath() + "/../ContentsInjectedBundle/libPageBundle.so", m_contentsGlue, m_options.maxProcesses, m_options.processPerSite);
+
+    WKStringRef wkStr = WKStringCreateWithUTF8CString("Content");
+    m_contentPageGroup = WKPageGroupCreateWithIdentifier(wkStr);
+    WKRelease(wkStr);
+    WKPreferencesRef webPreferences = WKPageGroupGetPreferences(m_contentPageGroup);
+    WKPreferencesSetWebAudioEnabled(webPreferences, true);
+    WKPreferencesSetWebGLEnabled(webPreferences, true);
+}
+
+void Browser::initUiView()
 {
     const std::string appPath = getApplicationPath();
     // FIXME Find a better way to find where the injected bundle is
@@ -130,11 +278,11 @@ void Browser::initUi()
     std::memset(&client, 0, sizeof(WKViewClient));
     client.version = kWKViewClientCurrentVersion;
     client.clientInfo = this;
-    client.viewNeedsDisplay = [](WKViewRef, WKRect, const void* client) {
-        ((Browser*)client)->scheduleUpdateDisplay();
+    client.viewNeedsDisplay = [](WKViewRef, WKRect rect, const void* client) {
+        ((Browser*)client)->uiNeedsDisplay(rect);
     };
-    client.webProcessCrashed = [](WKViewRef, WKURLRef, const void*) {
-        puts("UI Webprocess crashed :-(");
+    client.webProcessCrashed = [](WKViewRef, WKURLRef, const void* client) {
+        ((Browser*)client)->uiProcessCrashed();
     };
 
     WKViewSetViewClient(m_uiView, &client);
@@ -154,17 +302,37 @@ void Browser::initUi()
     m_glue->bindToDispatcher("_reload", this, &Tab::reload);
     m_glue->bindToDispatcher("_back", this, &Tab::back);
 
+    loadUi();
+}
+
+void Browser::loadUi()
+{
+    StartupTrace::mark(StartupTrace::UiLoadStarted);
+#if defined(EMBED_UI_RESOURCES)
+    if (m_uiHtml.empty())
+        m_uiHtml = inlinedUiHtml();
+    WKStringRef html = WKStringCreateWithUTF8CString(m_uiHtml.c_str());
+    WKPageLoadHTMLString(m_uiPage, html, 0);
+    WKRelease(html);
+#else
     std::string uiHtml = getUiFile();
     WKURLRef wkUrl = WKURLCreateWithUTF8CString(("file://" + uiHtml).c_str());
-    WKPageLoadURL(WKViewGetPage(m_uiView), wkUrl);
+    WKPageLoadURL(m_uiPage, wkUrl);
     WKRelease(wkUrl);
+#endif
+}
 
-    wkStr = WKStringCreateWithUTF8CString("Content");
-    m_contentPageGroup = WKPageGroupCreateWithIdentifier(wkStr);
-    WKRelease(wkStr);
-    WKPreferencesRef webPreferences = WKPageGroupGetPreferences(m_contentPageGroup);
-    WKPreferencesSetWebAudioEnabled(webPreferences, true);
-    WKPreferencesSetWebGLEnabled(webPreferences, true);
+void Browser::uiProcessCrashed()
+{
+    // The new process has no page to receive messages until it calls didUiReady.
+    m_uiReady = false;
+    int delay = m_uiCrashBackoff.crashed();
+    std::cerr << "UI Webprocess crashed :-(, restarting it in " << delay << "ms" << std::endl;
+    g_timeout_add_full(G_PRIORITY_DEFAULT, delay, [](gpointer data) -> gboolean {
+        // Tabs are sent to the new UI once it calls didUiReady.
+        static_cast<Browser*>(data)->loadUi();
+        return false;
+    }, this, 0);
 }
 
 int Browser::run()
@@ -190,7 +358,7 @@ void Browser::dispatchMessage(void (Obj::*method)())
 template<typename T>
 bool Browser::sendMouseEventToPage(T event)
 {
-    if (event->y > m_toolBarHeight && m_currentTab != -1) {
+    if (event->y >= m_toolBarHeight && m_currentTab != -1) {
         event->y -= m_toolBarHeight;
         currentTab()->sendMouseEvent(event);
         return true;
@@ -205,10 +373,14 @@ void Browser::onWindowExpose()
 
 void Browser::onKeyPress(NIXKeyEvent* event)
 {
-    if (!m_uiView)
+    m_powerMonitor.userActivity();
+    if (!m_chrome)
         return;
 
-    if (m_uiFocused)
+    if (m_nativeChrome) {
+        if (!m_nativeChrome->keyPress(event) && m_currentTab != -1)
+            currentTab()->sendKeyEvent(event);
+    } else if (m_uiFocused && m_uiView)
         NIXViewSendKeyEvent(m_uiView, event);
     else if (m_currentTab != -1)
         currentTab()->sendKeyEvent(event);
@@ -221,17 +393,23 @@ void Browser::onKeyRelease(NIXKeyEvent* event)
 
 void Browser::onMouseWheel(NIXWheelEvent* event)
 {
+    m_powerMonitor.userActivity();
     sendMouseEventToPage(event);
 }
 
 void Browser::onMousePress(NIXMouseEvent* event)
 {
-    if (!m_uiView)
+    m_powerMonitor.userActivity();
+    if (!m_chrome)
         return;
 
-    if (sendMouseEventToPage(event))
+    if (sendMouseEventToPage(event)) {
         m_uiFocused = false;
-    else {
+        if (m_nativeChrome)
+            m_nativeChrome->setUrlFocused(false);
+    } else if (m_nativeChrome)
+        m_uiFocused = m_nativeChrome->mousePress(event);
+    else if (m_uiView) {
         NIXMouseEvent releaseEvent;
         std::memcpy(&releaseEvent, event, sizeof(NIXMouseEvent));
         releaseEvent.type = kNIXInputEventTypeMouseUp;
@@ -244,29 +422,75 @@ void Browser::onMousePress(NIXMouseEvent* event)
 
 void Browser::onMouseRelease(NIXMouseEvent* event)
 {
+    m_powerMonitor.userActivity();
     sendMouseEventToPage(event);
 }
 
 void Browser::onMouseMove(NIXMouseEvent* event)
 {
-    if (!m_uiView)
+    m_powerMonitor.userActivity();
+    if (!m_chrome)
         return;
 
-    if (!sendMouseEventToPage(event))
+    if (!sendMouseEventToPage(event) && m_uiView)
         NIXViewSendMouseEvent(m_uiView, event);
 }
 
 void Browser::onWindowSizeChange(WKSize size)
 {
-    if (!m_uiView)
+    if (!m_chrome)
+        return;
+
+    // A drag resize sends lots of these, relayout happens once per frame and only on the current
+    // tab, hidden tabs are resized when they become current.
+    m_layoutPending = true;
+    scheduleUpdateDisplay();
+}
+
+void Browser::onWindowVisibilityChange(bool visible)
+{
+    if (visible == m_windowVisible)
         return;
 
-    WKViewSetSize(m_uiView, size);
+    // Nothing is painted while hidden, and hiding the pages lets WebKit throttle their timers and
+    // animations.
+    m_windowVisible = visible;
+    m_frameClock->setPaused(!visible);
+    if (m_uiView) {
+        waitForPendingPaints();
+        WKViewSetIsVisible(m_uiView, visible);
+    }
+    m_powerMonitor.setWindowVisible(visible);
+    if (m_currentTab != -1)
+        currentTab()->setVisibility(currentTabVisibility());
 
-    // FIXME: Procrastinate this relayout on non visible tabs
-    WKSize contentsSize = this->contentsSize();
-    for (auto p : m_tabs)
-        p.second->setSize(contentsSize);
+    // The window contents may have been lost meanwhile.
+    if (visible)
+        scheduleUpdateDisplay();
+}
+
+void Browser::onPowerStateChange(PowerMonitor::State state)
+{
+    // Hidden windows don't paint at all, see onWindowVisibilityChange().
+    if (state == PowerMonitor::Idle)
+        m_frameClock->setMaxFramesPerSecond(m_options.idleFramesPerSecond);
+    else
+        m_frameClock->setMaxFramesPerSecond(m_options.maxFramesPerSecond);
+
+    if (m_options.hideTabWhenIdle && m_currentTab != -1)
+        currentTab()->setVisibility(currentTabVisibility());
+}
+
+WKPageVisibilityState Browser::currentTabVisibility() const
+{
+    if (!m_windowVisible || (m_options.hideTabWhenIdle && m_powerMonitor.state() == PowerMonitor::Idle))
+        return kWKPageVisibilityStateHidden;
+    return kWKPageVisibilityStateVisible;
+}
+
+void Browser::gamepadActivity()
+{
+    m_powerMonitor.userActivity();
 }
 
 void Browser::onWindowClose()
@@ -274,14 +498,13 @@ void Browser::onWindowClose()
     g_main_loop_quit(m_mainLoop);
 }
 
-gboolean callUpdateDisplay(gpointer data)
+void Browser::onFrame()
 {
-    Browser* browser = reinterpret_cast<Browser*>(data);
-
-    assert(browser->m_displayUpdateScheduled);
-    browser->m_displayUpdateScheduled = false;
-    browser->updateDisplay();
-    return 0;
+    // Input that arrived while waiting for the frame must affect what we are about to paint.
+    m_window->dispatchPendingEvents();
+    if (m_layoutPending)
+        applyLayout();
+    updateDisplay();
 }
 
 WKSize Browser::contentsSize() const
@@ -293,28 +516,320 @@ WKSize Browser::contentsSize() const
 
 void Browser::scheduleUpdateDisplay()
 {
-    if (m_displayUpdateScheduled)
+    WKSize size = m_window->size();
+    uiNeedsDisplay(WKRectMake(0, 0, size.width, size.height));
+}
+
+void Browser::uiNeedsDisplay(const WKRect& rect)
+{
+    m_uiDamage.unite(rect);
+    m_frameClock->requestFrame();
+}
+
+void Browser::contentsNeedDisplay(const WKRect& rect)
+{
+    m_contentsDamage.unite(WKRectMake(rect.origin.x, rect.origin.y + m_toolBarHeight, rect.size.width, rect.size.height));
+    m_frameClock->requestFrame();
+}
+
+void Browser::tabNeedsDisplay(Tab* tab, const WKRect& rect)
+{
+    if (m_batchRenderer)
+        m_batchRenderer->tabNeedsDisplay(tab);
+    if (tab->id() != m_currentTab)
         return;
 
-    m_displayUpdateScheduled = true;
-    g_timeout_add(0, callUpdateDisplay, this);
+    if (m_placeholder != NoPlaceholder) {
+        // The first frame after the switch or relayout replaces the whole placeholder.
+        clearPlaceholder();
+        WKSize size = contentsSize();
+        contentsNeedDisplay(WKRectMake(0, 0, size.width, size.height));
+    } else
+        contentsNeedDisplay(rect);
+}
+
+void Browser::tabLoadFinished(Tab* tab)
+{
+    m_loadScheduler.loadFinished(tab);
+    if (m_batchRenderer)
+        m_batchRenderer->tabLoadFinished(tab);
+}
+
+void Browser::tabLoadFailed(Tab* tab)
+{
+    // The error page loaded instead isn't worth keeping a background load waiting.
+    m_loadScheduler.loadFinished(tab);
+}
+
+void Browser::tabCrashed(Tab* tab)
+{
+    // Its load won't finish, reloads after crashes aren't scheduled.
+    m_loadScheduler.loadFinished(tab);
+    m_hangMonitor.tabCrashed(tab->id());
+}
+
+void Browser::tabUnresponsive(Tab* tab)
+{
+    m_hangMonitor.tabUnresponsive(tab->id());
+}
+
+void Browser::tabResponsive(Tab* tab)
+{
+    m_hangMonitor.tabResponsive(tab->id());
+}
+
+void Browser::tabPong(const int& tabId)
+{
+    m_hangMonitor.pong(tabId);
+}
+
+void Browser::pingTab(int tabId)
+{
+    std::map<int, Tab*>::const_iterator tab = m_tabs.find(tabId);
+    if (tab != m_tabs.end())
+        tab->second->ping();
+}
+
+void Browser::killTab(int tabId)
+{
+    std::map<int, Tab*>::const_iterator tab = m_tabs.find(tabId);
+    if (tab != m_tabs.end())
+        tab->second->terminateHungProcess();
+}
+
+void Browser::tabUrlChanged(Tab* tab)
+{
+    if (m_session && !tab->url().empty())
+        m_session->urlChanged(tab->id(), tab->url());
+}
+
+void Browser::tabTitleChanged(Tab* tab)
+{
+    if (m_session && !tab->title().empty())
+        m_session->titleChanged(tab->id(), tab->title());
+}
+
+// Enough for triple buffering, older back buffers get fully repainted.
+static const size_t maxDamageHistory = 3;
+
+// How long a tab may take to paint after being switched to or relayouted before its placeholder
+// is dropped, in ms.
+static const guint placeholderTimeout = 500;
+
+static void setScissor(const WKRect& rect, const WKSize& windowSize)
+{
+    glScissor(rect.origin.x, windowSize.height - rect.origin.y - rect.size.height, rect.size.width, rect.size.height);
+}
+
+void Browser::updateUiBuffer(DamageRegion damage, const WKSize& size, cairo_surface_t* chromeImage)
+{
+    // Kiosk mode has no UI, so the buffer isn't even allocated.
+    if (!m_uiView && !m_nativeChrome)
+        return;
+    if (m_uiBuffer->size().width != size.width || m_uiBuffer->size().height != size.height)
+        damage = DamageRegion(WKRectMake(0, 0, size.width, size.height));
+    if (damage.isEmpty() || !m_uiBuffer->resize(size))
+        return;
+
+    m_uiBuffer->bind();
+    setScissor(damage.boundingRect(), size);
+    glClearColor(1.0, 1.0, 1.0, 1.0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    if (m_uiView)
+        WKViewPaintToCurrentGLContext(m_uiView);
+    m_uiBuffer->release();
+
+    // The native chrome was painted on the main thread, it's only uploaded to the top rows here.
+    if (chromeImage) {
+        int width = cairo_image_surface_get_width(chromeImage);
+        int height = cairo_image_surface_get_height(chromeImage);
+        // Cairo RGB24 is BGRX in memory on little endian machines.
+        glBindTexture(GL_TEXTURE_2D, m_uiBuffer->texture());
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, cairo_image_surface_get_stride(chromeImage) / 4);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, size.height - height, width, height, GL_BGRA, GL_UNSIGNED_BYTE, cairo_image_surface_get_data(chromeImage));
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
 }
 
 void Browser::updateDisplay()
 {
-    m_window->makeCurrent();
+    // Damage keeps accumulating until the render thread is done with the previous frame.
+    if (m_frameInFlight)
+        return;
 
     WKSize size = m_window->size();
+    WKRect windowRect = WKRectMake(0, 0, size.width, size.height);
+
+    Frame frame;
+    frame.size = size;
+    frame.toolBarHeight = m_toolBarHeight;
+    frame.uiDamage = m_uiDamage;
+    frame.uiDamage.intersect(windowRect);
+    frame.damage = m_uiDamage;
+    frame.damage.unite(m_contentsDamage);
+    frame.damage.intersect(windowRect);
+    m_uiDamage.clear();
+    m_contentsDamage.clear();
+    if (frame.damage.isEmpty())
+        return;
+
+    frame.tabId = m_currentTab;
+    frame.tabView = m_currentTab != -1 ? currentTab()->webView() : 0;
+    frame.placeholder = m_placeholder;
+    frame.tabHasContents = frame.tabView && !currentTab()->url().empty();
+    frame.chromeImage = m_nativeChrome && !frame.uiDamage.isEmpty() ? m_nativeChrome->paint(size.width) : 0;
+    frame.start = g_get_monotonic_time();
+    frame.interval = m_lastFrameStart ? frame.start - m_lastFrameStart : 0;
+    m_lastFrameStart = frame.start;
+
+    m_frameInFlight = true;
+    m_renderThread->post([this, frame] { renderFrame(frame); });
+}
+
+void Browser::waitForPendingPaints()
+{
+    if (!m_frameInFlight && !m_captureQueued)
+        return;
+    m_renderThread->sync([] { });
+    m_captureQueued = false;
+}
+
+void Browser::renderFrame(const Frame& frame)
+{
+    const WKSize& size = frame.size;
+    WKRect windowRect = WKRectMake(0, 0, size.width, size.height);
+    WKRect toolBarRect = WKRectMake(0, 0, size.width, frame.toolBarHeight);
+    WKRect contentsRect = WKRectMake(0, frame.toolBarHeight, size.width, size.height - frame.toolBarHeight);
+
+    FrameTiming timing;
+    timing.start = frame.start;
+    timing.interval = frame.interval;
+    int64_t renderStart = g_get_monotonic_time();
+
+    // The HUD shows this frame in the statistics, so it changes whenever something else does.
+    DamageRegion damage(frame.damage);
+    if (m_performanceHud)
+        damage.unite(m_performanceHud->rect(contentsRect));
+
+    // The back buffer may miss what was painted on previous frames, find what must be repainted to
+    // bring it up to date. glXCopySubBuffer never changes the back buffer, so it's always current.
+    DamageRegion repaint(damage);
+    int age = m_window->backBufferAge();
+    bool copySubBuffer = age < 0 && m_window->canCopySubBuffer();
+    if (age > 0 && size_t(age) <= m_damageHistory.size() + 1) {
+        for (int i = 0; i < age - 1; ++i)
+            repaint.unite(m_damageHistory[i]);
+    } else if (!copySubBuffer)
+        repaint = DamageRegion(windowRect);
+
+    m_damageHistory.push_front(damage);
+    if (m_damageHistory.size() > maxDamageHistory)
+        m_damageHistory.pop_back();
+
+    const WKRect& repaintRect = repaint.boundingRect();
     glViewport(0, 0, size.width, size.height);
+    glEnable(GL_SCISSOR_TEST);
+    updateUiBuffer(frame.uiDamage, size, frame.chromeImage);
+    if (frame.chromeImage)
+        cairo_surface_destroy(frame.chromeImage);
+
+    setScissor(repaintRect, size);
     glClearColor(1.0, 1.0, 1.0, 1.0);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    WKViewPaintToCurrentGLContext(m_uiView);
+    // The current tab covers the UI view below the toolbar, so each view is only painted if the
+    // repainted area touches it.
+    if (!frame.tabView || repaint.intersects(toolBarRect)) {
+        if (m_uiBuffer->isValid())
+            m_uiBuffer->blitToWindow(repaintRect, size);
+        else if (m_uiView)
+            WKViewPaintToCurrentGLContext(m_uiView);
+    }
+    int64_t uiPainted = g_get_monotonic_time();
+    timing.uiPaint = uiPainted - renderStart;
 
-    if (m_currentTab != -1)
-        WKViewPaintToCurrentGLContext(currentTab()->webView());
+    bool paintedContents = false;
+    if (frame.tabView && repaint.intersects(contentsRect)) {
+        OffscreenBuffer* thumbnail = frame.placeholder == ThumbnailPlaceholder ? m_thumbnails->get(frame.tabId) : 0;
+        if (thumbnail)
+            thumbnail->scaleToWindow(contentsRect, size);
+        else if (frame.placeholder == StretchedFramePlaceholder && m_lastFrame->isValid()) {
+            WKSize lastSize = m_lastFrame->size();
+            WKRect lastContentsRect = WKRectMake(0, m_lastFrameToolBarHeight, lastSize.width, lastSize.height - m_lastFrameToolBarHeight);
+            m_lastFrame->scaleToWindow(lastContentsRect, contentsRect, size);
+        } else {
+            WKViewPaintToCurrentGLContext(frame.tabView);
+            paintedContents = frame.tabHasContents;
+        }
+    }
+    int64_t contentsPainted = g_get_monotonic_time();
+    timing.contentsPaint = contentsPainted - uiPainted;
+
+    glDisable(GL_SCISSOR_TEST);
+    updateLastFrame(frame, repaintRect);
+
+    if (m_performanceHud)
+        m_performanceHud->paint(*m_frameTimings, contentsRect, size);
+
+    int64_t swapStart = g_get_monotonic_time();
+    if (copySubBuffer)
+        m_window->copySubBuffer(repaintRect, size);
+    else
+        m_window->swapBuffers();
+    timing.swap = g_get_monotonic_time() - swapStart;
+    if (paintedContents)
+        StartupTrace::mark(StartupTrace::FirstContentFrameSwapped);
 
-    m_window->swapBuffers();
+    // Only this thread writes the timings, the HUD reads them from here too.
+    m_frameTimings->add(timing);
+
+    g_idle_add_full(G_PRIORITY_HIGH, [](gpointer data) -> gboolean {
+        static_cast<Browser*>(data)->frameFinished();
+        return false;
+    }, this, 0);
+}
+
+void Browser::updateLastFrame(const Frame& frame, const WKRect& repaintRect)
+{
+    // Keep the stretched frame as it was before the resize.
+    if (frame.placeholder == StretchedFramePlaceholder) {
+        m_lastFrameStale = true;
+        return;
+    }
+
+    // Everything on the back buffer is up to date at this point, so only what was repainted
+    // needs to be copied, unless the copy is missing earlier frames.
+    const WKSize& size = frame.size;
+    WKRect rect = repaintRect;
+    if (m_lastFrameStale || m_lastFrame->size().width != size.width || m_lastFrame->size().height != size.height) {
+        if (!m_lastFrame->resize(size))
+            return;
+        rect = WKRectMake(0, 0, size.width, size.height);
+    }
+    m_lastFrame->copyFromWindow(rect, size);
+    m_lastFrameToolBarHeight = frame.toolBarHeight;
+    m_lastFrameStale = false;
+}
+
+void Browser::frameFinished()
+{
+    m_frameInFlight = false;
+    if (StartupTrace::isComplete())
+        finishStartupTrace();
+    if (!m_uiDamage.isEmpty() || !m_contentsDamage.isEmpty())
+        m_frameClock->requestFrame();
+}
+
+void Browser::finishStartupTrace()
+{
+    if (m_startupTraced)
+        return;
+
+    m_startupTraced = true;
+    std::cout << StartupTrace::summary() << std::endl;
+    if (!m_options.startupTraceFile.empty() && !StartupTrace::writeToFile(m_options.startupTraceFile))
+        std::cerr << "Can't write the startup trace to " << m_options.startupTraceFile << std::endl;
 }
 
 Tab* Browser::currentTab()
@@ -324,67 +839,414 @@ Tab* Browser::currentTab()
 
 void Browser::didUiReady()
 {
-    if (m_initialUrls.empty())
-        requestTab();
-    else {
+    StartupTrace::mark(StartupTrace::UiReady);
+    m_uiReady = true;
+    // The UI was restarted after a crash.
+    if (!m_tabs.empty()) {
+        replayUiState();
+        return;
+    }
+
+    if (m_batchRenderer) {
+        m_batchRenderer->start();
+        return;
+    }
+
+    if (m_options.kiosk) {
         m_uiFocused = false;
-        for (const std::string& url : m_initialUrls)
-            requestTab()->loadUrl(url);
+        // Like the tab shown when several URLs are given, but the others aren't opened at all.
+        if (m_options.urls.empty())
+            requestTab();
+        else
+            requestTabForUrl(m_options.urls.back());
+        return;
+    }
+
+    bool restoringSession = m_session && !m_session->savedTabs().empty();
+    if (restoringSession)
+        restoreSession();
+    if (!m_options.urls.empty()) {
+        m_uiFocused = false;
+        if (m_nativeChrome)
+            m_nativeChrome->setUrlFocused(false);
+        // The last tab is the one shown, the others wait for their turn to load.
+        for (size_t i = 0; i < m_options.urls.size(); ++i)
+            requestTabForUrl(m_options.urls[i], i + 1 < m_options.urls.size());
+    } else if (!restoringSession) {
+        requestTab();
+    }
+    if (m_session)
+        m_session->start();
+    scheduleSpareTab();
+}
+
+// Time between loads of restored tabs that weren't selected yet.
+static const guint sessionTrickleInterval = 3000;
+
+void Browser::restoreSession()
+{
+    const std::vector<SessionJournal::Tab>& savedTabs = m_session->savedTabs();
+    size_t current = std::max(m_session->savedCurrentTab(), 0);
+    for (size_t i = 0; i < savedTabs.size(); ++i) {
+        // Only the current tab loads now, the others start discarded.
+        Tab* tab = addTab(new Tab(this, savedTabs[i].url, savedTabs[i].title), i != current);
+        tabUrlChanged(tab);
+        tabTitleChanged(tab);
+        if (!tab->url().empty())
+            m_chrome->urlChanged(tab->id(), tab->url());
+        if (!tab->title().empty())
+            m_chrome->titleChanged(tab->id(), tab->title());
+        // The native chrome selects, and so restores, the current tab right away.
+        if (tab->isDiscarded())
+            m_chrome->tabDiscarded(tab->id(), true);
+        if (i != current)
+            m_pendingSessionTabs.push_back(tab->id());
+    }
+
+    if (!m_pendingSessionTabs.empty()) {
+        m_sessionTrickleTimer = g_timeout_add_full(G_PRIORITY_LOW, sessionTrickleInterval, [](gpointer data) -> gboolean {
+            Browser* self = static_cast<Browser*>(data);
+            self->loadNextSessionTab();
+            if (!self->m_pendingSessionTabs.empty())
+                return true;
+            self->m_sessionTrickleTimer = 0;
+            return false;
+        }, this, 0);
+    }
+}
+
+void Browser::loadNextSessionTab()
+{
+    if (m_memoryMonitor.isUnderPressure())
+        return;
+
+    while (!m_pendingSessionTabs.empty()) {
+        int tabId = m_pendingSessionTabs.front();
+        m_pendingSessionTabs.pop_front();
+        // Closed or selected meanwhile.
+        if (!m_tabs.count(tabId) || !m_tabs[tabId]->isDiscarded())
+            continue;
+
+        restoreTab(m_tabs[tabId], false);
+        return;
+    }
+}
+
+void Browser::restoreTab(Tab* tab, bool foreground)
+{
+    m_loadScheduler.load(tab, [this, tab, foreground] {
+        if (!tab->restore(acquireContext(tab->url())))
+            m_loadScheduler.loadFinished(tab);
+        // Selected tabs catch up with the layout in setCurrentTab().
+        if (!foreground) {
+            tab->setViewportTranslation(0, m_toolBarHeight);
+            tab->setSize(contentsSize());
+        }
+        m_chrome->tabDiscarded(tab->id(), false);
+    }, foreground);
+}
+
+void Browser::replayUiState()
+{
+    for (std::pair<const int, Tab*> p : m_tabs) {
+        Tab* tab = p.second;
+        m_chrome->tabAdded(tab->id(), p.first != m_currentTab);
+        if (!tab->url().empty())
+            m_chrome->urlChanged(tab->id(), tab->url());
+        if (!tab->title().empty())
+            m_chrome->titleChanged(tab->id(), tab->title());
+        if (tab->isDiscarded())
+            m_chrome->tabDiscarded(tab->id(), true);
     }
 }
 
 Tab* Browser::requestTab(Tab* parent)
 {
-    Tab* tab = parent ? new Tab(parent) : new Tab(this);
-    tab->setViewportTranslation(0, m_toolBarHeight);
+    // Popups must stay in the process of the page that opened them. Kiosk mode has a single tab.
+    if (parent)
+        return m_options.kiosk ? 0 : addTab(new Tab(parent));
+    Tab* tab = takeSpareTab();
+    return addTab(tab ? tab : new Tab(this, acquireContext(std::string())));
+}
+
+Tab* Browser::requestTabForUrl(const std::string& url, bool background)
+{
+    // The spare tab isn't in any site's process.
+    Tab* tab = m_options.processPerSite ? 0 : takeSpareTab();
+    tab = addTab(tab ? tab : new Tab(this, acquireContext(url)), background);
+    // Queued tabs show where they're going meanwhile.
+    m_chrome->urlChanged(tab->id(), url);
+    m_loadScheduler.load(tab, url, !background);
+    return tab;
+}
+
+Tab* Browser::takeSpareTab()
+{
+    Tab* tab = m_spareTab;
+    m_spareTab = 0;
+    if (tab)
+        scheduleSpareTab();
+    return tab;
+}
+
+void Browser::scheduleSpareTab()
+{
+    if (m_options.disableSpareTab || m_spareTab || m_spareTabSource || m_memoryMonitor.isUnderPressure())
+        return;
+
+    m_spareTabSource = g_idle_add_full(G_PRIORITY_LOW, [](gpointer data) -> gboolean {
+        Browser* self = static_cast<Browser*>(data);
+        self->m_spareTabSource = 0;
+        // Starts the web process and its injected bundle, the tab stays hidden until adopted.
+        self->m_spareTab = new Tab(self, self->acquireContext(std::string()));
+        self->m_spareTab->setViewportTranslation(0, self->m_toolBarHeight);
+        self->m_spareTab->setSize(self->contentsSize());
+        return false;
+    }, this, 0);
+}
+
+Tab* Browser::addTab(Tab* tab, bool background)
+{
+    if (!tab->isDiscarded()) {
+        tab->setViewportTranslation(0, m_toolBarHeight);
+        tab->setSize(contentsSize());
+    }
     m_tabs[tab->id()] = tab;
-    tab->setSize(contentsSize());
-    postToBundle(m_uiPage, "tabAdded", tab->id());
+    StartupTrace::mark(StartupTrace::FirstTabCreated);
+    // The UI selects new tabs unless told they're in the background.
+    m_chrome->tabAdded(tab->id(), background);
+    if (m_options.kiosk && !background)
+        setCurrentTab(tab->id());
+    if (m_session)
+        m_session->tabAdded(tab->id());
     return tab;
 }
 
+WKContextRef Browser::acquireContext(const std::string& url)
+{
+    size_t processes = m_contextPool->processCount();
+    WKContextRef context = m_contextPool->acquire(url);
+    if (m_contextPool->processCount() != processes)
+        std::cout << m_contextPool->stats() << std::endl;
+    return context;
+}
+
 void Browser::closeTab(const int& tabId)
 {
     assert(m_tabs.count(tabId) != 0);
 
     Tab* tab = m_tabs[tabId];
     m_tabs.erase(tabId);
+    if (m_session)
+        m_session->tabClosed(tabId);
     m_currentTab = -1;
+    clearPlaceholder();
+    // Also waits for queued frames and thumbnail captures that may still paint the tab.
+    m_renderThread->sync([this, tabId] {
+        if (m_thumbnails)
+            m_thumbnails->remove(tabId);
+    });
+    m_loadScheduler.cancel(tab);
     delete tab;
     if (m_tabs.empty())
         onWindowClose();
+    else
+        scheduleUpdateDisplay();
 }
 
 void Browser::toolBarHeightChanged(const int& height)
 {
     m_toolBarHeight = height;
 
-    // FIXME: Better to delay this global relayout in a near future
-    WKSize contentsSize = this->contentsSize();
-    for (auto p : m_tabs) {
-        Tab* tab = p.second;
-        tab->setViewportTranslation(0, m_toolBarHeight);
-        tab->setSize(contentsSize);
-    }
+    // Applied on the next frame, like window resizes.
+    m_layoutPending = true;
+    scheduleUpdateDisplay();
+}
+
+void Browser::applyLayout()
+{
+    m_layoutPending = false;
+    waitForPendingPaints();
+    if (m_uiView)
+        WKViewSetSize(m_uiView, m_window->size());
+    if (m_currentTab == -1)
+        return;
+
+    Tab* tab = currentTab();
+    WKSize oldSize = WKViewGetSize(tab->webView());
+    WKSize size = contentsSize();
+    tab->setViewportTranslation(0, m_toolBarHeight);
+    if (oldSize.width == size.width && oldSize.height == size.height)
+        return;
+
+    // The old layout would be painted at the wrong size until the tab catches up.
+    if (m_placeholder == NoPlaceholder)
+        showPlaceholder(StretchedFramePlaceholder);
+    tab->setSize(size);
 }
 
 void Browser::setCurrentTab(const int& tabId)
 {
-    if (!m_tabs.count(tabId))
+    if (!m_tabs.count(tabId) || tabId == m_currentTab)
         return;
 
-    if (m_currentTab != -1)
+    if (m_currentTab != -1) {
+        // A tab showing a placeholder has nothing newer to capture.
+        if (m_placeholder == NoPlaceholder)
+            captureThumbnail(currentTab());
         currentTab()->setVisibility(kWKPageVisibilityStateHidden);
+    }
+    clearPlaceholder();
 
     m_currentTab = tabId;
+    if (m_session)
+        m_session->currentTabChanged(tabId);
 
     Tab* tab = currentTab();
-    WKViewSetSize(tab->webView(), contentsSize());
-    tab->setVisibility(kWKPageVisibilityStateVisible);
+    if (tab->isDiscarded())
+        restoreTab(tab, true);
+
+    // Hidden tabs miss the relayouts, catch up now.
+    WKSize oldSize = WKViewGetSize(tab->webView());
+    WKSize size = contentsSize();
+    bool resized = oldSize.width != size.width || oldSize.height != size.height;
+    tab->setViewportTranslation(0, m_toolBarHeight);
+    tab->setSize(size);
+
+    // Tabs that changed while hidden take a while to repaint, so show how they looked meanwhile.
+    // Tabs without a thumbnail just paint as they are.
+    if (m_thumbnails && (tab->needsDisplay() || resized))
+        showPlaceholder(ThumbnailPlaceholder);
+
+    tab->setVisibility(currentTabVisibility());
+    m_loadScheduler.tabSelected(tab);
+    updateProcessGroups();
+    scheduleUpdateDisplay();
+}
+
+void Browser::onMemoryPressure()
+{
+    // The spare tab goes first, it's created again once memory is back.
+    if (m_spareTab) {
+        std::cout << "Memory pressure, dropping the spare tab" << std::endl;
+        delete m_spareTab;
+        m_spareTab = 0;
+        m_contextPool->releaseUnusedContexts();
+        return;
+    }
+
+    // One tab per poll, so the memory it frees is seen before discarding more.
+    Tab* leastRecentlyUsed = 0;
+    for (std::pair<const int, Tab*> p : m_tabs) {
+        Tab* tab = p.second;
+        if (p.first == m_currentTab || tab->isDiscarded())
+            continue;
+        if (!leastRecentlyUsed || tab->lastVisibleTime() < leastRecentlyUsed->lastVisibleTime())
+            leastRecentlyUsed = tab;
+    }
+    if (!leastRecentlyUsed)
+        return;
+
+    std::cout << "Memory pressure, discarding tab " << leastRecentlyUsed->id() << std::endl;
+    // Frames and thumbnail captures may still be painting the view.
+    m_renderThread->sync([] { });
+    m_loadScheduler.cancel(leastRecentlyUsed);
+    leastRecentlyUsed->discard();
+    m_contextPool->releaseUnusedContexts();
+    m_chrome->tabDiscarded(leastRecentlyUsed->id(), true);
+}
+
+std::vector<ResourceMonitor::TabProcess> Browser::tabProcesses()
+{
+    std::vector<ResourceMonitor::TabProcess> processes;
+    for (std::pair<const int, Tab*> p : m_tabs) {
+        ResourceMonitor::TabProcess process = { p.first, p.second->processId(), p.second->suppressedDisplayRequests() };
+        processes.push_back(process);
+    }
+    return processes;
+}
+
+void Browser::onResourceUsage(const std::vector<ResourceMonitor::Usage>& usage)
+{
+    for (const ResourceMonitor::Usage& tab : usage)
+        m_chrome->tabResourceUsage(tab.tabId, tab.cpuPercent, tab.pssKilobytes / 1024.0);
+    // Also catches the processes started since the last tab switch.
+    updateProcessGroups();
+}
+
+void Browser::updateProcessGroups()
+{
+    if (!m_processGroups)
+        return;
+
+    // A process is in the foreground if any of its tabs is the current one.
+    std::map<pid_t, bool> foreground;
+    for (std::pair<const int, Tab*> p : m_tabs) {
+        pid_t pid = p.second->processId();
+        if (pid > 0)
+            foreground[pid] = foreground[pid] || p.first == m_currentTab;
+    }
+    m_processGroups->place(foreground);
+}
+
+// Thumbnails are stored at this fraction of the contents size.
+static const int thumbnailScale = 2;
+
+void Browser::captureThumbnail(Tab* tab)
+{
+    WKSize size = m_window->size();
+    WKSize contentsSize = this->contentsSize();
+    if (!m_thumbnails || contentsSize.width < thumbnailScale || contentsSize.height < thumbnailScale)
+        return;
+
+    // The tab is painted again instead of reading back the window, which may have the HUD on top.
+    WKViewRef view = tab->webView();
+    int tabId = tab->id();
+    WKRect contentsRect = WKRectMake(0, m_toolBarHeight, contentsSize.width, contentsSize.height);
+    m_captureQueued = true;
+    m_renderThread->post([this, view, tabId, size, contentsRect] {
+        if (!m_thumbnailCaptureBuffer->resize(size))
+            return;
+        m_thumbnailCaptureBuffer->bind();
+        glViewport(0, 0, size.width, size.height);
+        glClearColor(1.0, 1.0, 1.0, 1.0);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        WKViewPaintToCurrentGLContext(view);
+        m_thumbnailCaptureBuffer->release();
+
+        WKSize thumbnailSize = WKSizeMake(contentsRect.size.width / thumbnailScale, contentsRect.size.height / thumbnailScale);
+        if (OffscreenBuffer* thumbnail = m_thumbnails->store(tabId, thumbnailSize))
+            thumbnail->scaleFrom(*m_thumbnailCaptureBuffer, contentsRect);
+    });
+}
+
+void Browser::showPlaceholder(ContentsPlaceholder placeholder)
+{
+    clearPlaceholder();
+    m_placeholder = placeholder;
+
+    // Tabs that don't repaint at all after a change are caught by the timeout.
+    m_placeholderTimeout = g_timeout_add(placeholderTimeout, [](gpointer data) -> gboolean {
+        Browser* self = static_cast<Browser*>(data);
+        self->m_placeholderTimeout = 0;
+        self->clearPlaceholder();
+        self->scheduleUpdateDisplay();
+        return false;
+    }, this);
+}
+
+void Browser::clearPlaceholder()
+{
+    if (m_placeholderTimeout)
+        g_source_remove(m_placeholderTimeout);
+    m_placeholderTimeout = 0;
+    m_placeholder = NoPlaceholder;
 }
 
 void Browser::loadUrlOnCurrentTab(const std::string& url)
 {
     m_uiFocused = false;
-    currentTab()->loadUrl(url);
+    if (m_nativeChrome)
+        m_nativeChrome->setUrlFocused(false);
+    m_loadScheduler.load(currentTab(), url, true);
 }
@@ -26,27 +26,101 @@
 #ifndef Browser_h
 #define Browser_h
 
+#include "CrashBackoff.h"
+#include "DamageRegion.h"
 #include "DesktopWindow.h"
+#include "FrameClock.h"
+#include "HangMonitor.h"
+#include "LoadScheduler.h"
+#include "MemoryPressureMonitor.h"
+#include "PowerMonitor.h"
+#include "ResourceMonitor.h"
 #include <glib.h>
 #include <NIXView.h>
+#include <WebKit2/WKPageVisibilityTypes.h>
+#include <deque>
 #include <map>
 #include <string>
 #include <vector>
 
+class BatchRenderer;
+class Chrome;
+class ContextPool;
+class FrameTimings;
+class NativeChrome;
+class OffscreenBuffer;
+class PerformanceHud;
+class ProcessGroups;
+class RenderThread;
+class SessionJournal;
 class Tab;
+class TabThumbnailCache;
+typedef struct _cairo_surface cairo_surface_t;
 
 std::string getApplicationPath();
 
-extern "C" {
-gboolean callUpdateDisplay(gpointer);
-}
-
 class InjectedBundleGlue;
 
-class Browser : public DesktopWindowClient
+struct BrowserOptions
+{
+    BrowserOptions() : maxFramesPerSecond(0), showPerformanceHud(false), headless(false), batchJobs(1), batchFrames(10), thumbnailCacheMegabytes(32), idleTimeout(0), idleFramesPerSecond(1), hideTabWhenIdle(false), maxProcesses(0), processPerSite(false), disableSpareTab(false), tabDiscardThreshold(200), crashRetries(5), backgroundCpuPercent(25), maxLoads(4), nativeChrome(false), kiosk(false), hangTimeout(10) {}
+
+    std::vector<std::string> urls;
+    // 0 means no cap other than the display refresh rate.
+    int maxFramesPerSecond;
+    bool showPerformanceHud;
+    // Where to save the frame timings on exit, empty to not save them.
+    std::string frameTimingsFile;
+    // Render offscreen, without a window system, reading input from inputScript.
+    bool headless;
+    std::string inputScript;
+    // Batch render the URLs into this directory instead of running interactively, see BatchRenderer.
+    std::string batchOutputDirectory;
+    int batchJobs;
+    int batchFrames;
+    // Memory budget of TabThumbnailCache, 0 disables it.
+    int thumbnailCacheMegabytes;
+    // Seconds without input before going idle, 0 disables idle detection. See PowerMonitor.
+    int idleTimeout;
+    int idleFramesPerSecond;
+    // Also hide the current tab while idle, so WebKit throttles its timers and animations.
+    bool hideTabWhenIdle;
+    // Where to save the time spent on each power state on exit, empty to not save it.
+    std::string powerStatsFile;
+    // Web processes shared by all tabs, 0 gives each tab its own. See ContextPool.
+    int maxProcesses;
+    // Put tabs of the same site in the same web process.
+    bool processPerSite;
+    // Don't keep a hidden tab ready for the next new tab.
+    bool disableSpareTab;
+    // Available memory in MB below which background tabs are discarded, 0 to never discard them.
+    int tabDiscardThreshold;
+    // Crashes in a row after which a tab isn't reloaded anymore, 0 always reloads it.
+    int crashRetries;
+    // Where to keep the open tabs to restore them on the next run, empty to not keep them.
+    std::string sessionFile;
+    // Where to log the CPU and memory use of each tab as CSV, empty to not log it.
+    std::string resourceLogFile;
+    // CPU quota of the web processes without a visible tab, 0 to not throttle them. See ProcessGroups.
+    int backgroundCpuPercent;
+    // Empty delegated cgroup v2 to put the web processes in, empty to only set their OOM scores.
+    std::string cgroup;
+    // Tabs loading at once, not counting the current one, 0 for no limit.
+    int maxLoads;
+    // Where to save the startup milestones as a Chrome trace, empty to only print a summary.
+    std::string startupTraceFile;
+    // Paint the tabs and URL bar in the browser process instead of running ui.html in a web process.
+    bool nativeChrome;
+    // A single full screen tab, without tab strip nor URL bar. Popups load in that tab.
+    bool kiosk;
+    // Seconds a tab can stay unresponsive before its web process is terminated, 0 to never do it.
+    int hangTimeout;
+};
+
+class Browser : public DesktopWindowClient, public FrameClock::Client, public PowerMonitor::Client, public MemoryPressureMonitor::Client, public ResourceMonitor::Client, public HangMonitor::Client
 {
 public:
-    Browser(const std::vector<std::string>& urls);
+    Browser(const BrowserOptions&);
     ~Browser();
 
     int run();
@@ -60,11 +134,32 @@ public:
     virtual void onMouseMove(NIXMouseEvent*);
     virtual void onMouseWheel(NIXWheelEvent*);
     virtual void onWindowSizeChange(WKSize);
+    virtual void onWindowVisibilityChange(bool visible);
     virtual void onWindowClose();
 
+    // FrameClock::Client
+    virtual void onFrame();
+
+    // PowerMonitor::Client
+    virtual void onPowerStateChange(PowerMonitor::State);
+
+    // MemoryPressureMonitor::Client
+    virtual void onMemoryPressure();
+
+    // ResourceMonitor::Client
+    virtual std::vector<ResourceMonitor::TabProcess> tabProcesses();
+    virtual void onResourceUsage(const std::vector<ResourceMonitor::Usage>&);
+
+    // HangMonitor::Client, tabProcesses() is shared with ResourceMonitor::Client.
+    virtual void pingTab(int tabId);
+    virtual void killTab(int tabId);
+
     void didUiReady();
     Tab* requestTab(Tab* parent);
     Tab* requestTab() { return requestTab(0); }
+    // Opens a tab in the web process picked for the URL and loads it, background tabs aren't
+    // selected and wait for the LoadScheduler.
+    Tab* requestTabForUrl(const std::string& url, bool background = false);
     void closeTab(const int& tabId);
     void toolBarHeightChanged(const int& height);
     void setCurrentTab(const int& tabId);
@@ -76,42 +171,172 @@ public:
     template<typename Obj>
     void dispatchMessage(void (Obj::*method)());
 
+    const BrowserOptions& options() const { return m_options; }
     WKPageRef ui() { return m_uiPage; }
+    // False until the UI page calls didUiReady, and again while its process restarts after a crash.
+    bool isUiReady() const { return m_uiReady; }
+    Chrome* chrome() { return m_chrome; }
     WKPageGroupRef contentPageGroup() { return m_contentPageGroup; }
+    // Receives the messages from the injected bundle of all tab contexts.
+    InjectedBundleGlue* contentsGlue() { return m_contentsGlue; }
+    ContextPool* contextPool() { return m_contextPool; }
 
     WKSize contentsSize() const;
 
+    // Schedules a repaint of the whole window.
     void scheduleUpdateDisplay();
+    void uiNeedsDisplay(const WKRect&);
+    void contentsNeedDisplay(const WKRect&);
+    void tabNeedsDisplay(Tab*, const WKRect&);
+    void tabLoadFinished(Tab*);
+    void tabLoadFailed(Tab*);
+    void tabUrlChanged(Tab*);
+    void tabCrashed(Tab*);
+    void tabUnresponsive(Tab*);
+    void tabResponsive(Tab*);
+    void tabTitleChanged(Tab*);
 
     DesktopWindow* window() { return m_window; }
+    RenderThread* renderThread() { return m_renderThread; }
+    // Frames and thumbnail captures queued on the render thread may still paint the views, they
+    // must be done before a view is resized or hidden. Doesn't block when there are none.
+    void waitForPendingPaints();
 
 private:
     GMainLoop* m_mainLoop;
-    bool m_displayUpdateScheduled;
+    BrowserOptions m_options;
     DesktopWindow* m_window;
+    FrameClock* m_frameClock;
+    RenderThread* m_renderThread;
+    // Only one frame is handed to the render thread at a time.
+    bool m_frameInFlight;
+    // A thumbnail capture was posted since the last waitForPendingPaints().
+    bool m_captureQueued;
     InjectedBundleGlue* m_glue;
+    InjectedBundleGlue* m_contentsGlue;
+    PowerMonitor m_powerMonitor;
+    MemoryPressureMonitor m_memoryMonitor;
+    ResourceMonitor m_resourceMonitor;
+    ProcessGroups* m_processGroups;
+    LoadScheduler m_loadScheduler;
+    HangMonitor m_hangMonitor;
+
+    // What is painted instead of the current tab until it paints a frame after being switched to
+    // or resized.
+    enum ContentsPlaceholder {
+        NoPlaceholder,
+        // The tab thumbnail, see TabThumbnailCache.
+        ThumbnailPlaceholder,
+        // The last frame, stretched to the new window size.
+        StretchedFramePlaceholder
+    };
+
+    // What the render thread needs to paint a frame, taken on the main thread.
+    struct Frame {
+        WKSize size;
+        int toolBarHeight;
+        DamageRegion uiDamage;
+        DamageRegion damage;
+        int tabId;
+        WKViewRef tabView;
+        ContentsPlaceholder placeholder;
+        // The tab committed a load, so painting it shows a page.
+        bool tabHasContents;
+        // The native chrome as painted for this frame, or null if unchanged. See NativeChrome::paint().
+        cairo_surface_t* chromeImage;
+        int64_t start;
+        int64_t interval;
+    };
+
+    // Window coordinates, WebKit reports the damage of each view separately.
+    DamageRegion m_uiDamage;
+    DamageRegion m_contentsDamage;
+    // What was repainted on the last frames, most recent first, used to bring older back buffers up to date.
+    // Like the GL resources below, only used on the render thread.
+    std::deque<DamageRegion> m_damageHistory;
+    // The UI view is rendered here and composited from it, so it's only repainted when it changes.
+    OffscreenBuffer* m_uiBuffer;
+
+    BatchRenderer* m_batchRenderer;
 
+    // The cache itself is only used on the render thread.
+    TabThumbnailCache* m_thumbnails;
+    OffscreenBuffer* m_thumbnailCaptureBuffer;
+    // A copy of the window as of the last frame, render thread only.
+    OffscreenBuffer* m_lastFrame;
+    int m_lastFrameToolBarHeight;
+    bool m_lastFrameStale;
+    ContentsPlaceholder m_placeholder;
+    guint m_placeholderTimeout;
+    // Window and toolbar size changes wait for the next frame to be applied.
+    bool m_layoutPending;
+
+    // Written by the render thread.
+    FrameTimings* m_frameTimings;
+    PerformanceHud* m_performanceHud;
+    int64_t m_lastFrameStart;
+    bool m_startupTraced;
+
+    // Either a WebChrome driving the UI view below or the NativeChrome, which has no view.
+    Chrome* m_chrome;
+    NativeChrome* m_nativeChrome;
     WKViewRef m_uiView;
     WKPageRef m_uiPage;
     WKContextRef m_uiContext;
     WKPageGroupRef m_uiPageGroup;
+    // Built once from the resources compiled in, the UI is loaded again after crashes.
+    std::string m_uiHtml;
+    // The UI is restarted for as long as it keeps crashing.
+    CrashBackoff m_uiCrashBackoff;
+    bool m_uiReady;
 
     bool m_uiFocused;
+    bool m_windowVisible;
     int m_toolBarHeight;
 
+    ContextPool* m_contextPool;
+    // Created when the main loop is idle, so new tabs don't wait for a web process to start.
+    Tab* m_spareTab;
+    guint m_spareTabSource;
+    SessionJournal* m_session;
+    // Restored tabs not selected yet, loaded in the background one at a time.
+    std::deque<int> m_pendingSessionTabs;
+    guint m_sessionTrickleTimer;
     std::map<int, Tab*> m_tabs;
     int m_currentTab;
     WKPageGroupRef m_contentPageGroup;
 
-    const std::vector<std::string>& m_initialUrls;
-
     template<typename T>
     bool sendMouseEventToPage(T event);
 
     void updateDisplay();
+    void renderFrame(const Frame&);
+    void updateLastFrame(const Frame&, const WKRect& repaintRect);
+    void frameFinished();
+    // Prints the startup summary and writes the trace once, with the milestones reached so far.
+    void finishStartupTrace();
+    void updateUiBuffer(DamageRegion, const WKSize&, cairo_surface_t* chromeImage);
+    void applyLayout();
+    Tab* addTab(Tab*, bool background = false);
+    void restoreSession();
+    void updateProcessGroups();
+    void loadNextSessionTab();
+    // Restores a discarded tab through the load scheduler.
+    void restoreTab(Tab*, bool foreground);
+    Tab* takeSpareTab();
+    void scheduleSpareTab();
+    WKContextRef acquireContext(const std::string& url);
+    void gamepadActivity();
+    void tabPong(const int& tabId);
+    WKPageVisibilityState currentTabVisibility() const;
+    void captureThumbnail(Tab*);
+    void showPlaceholder(ContentsPlaceholder);
+    void clearPlaceholder();
     void initUi();
-
-    friend gboolean callUpdateDisplay(gpointer);
+    void initUiView();
+    void loadUi();
+    void uiProcessCrashed();
+    void replayUiState();
 };
 
 #endif
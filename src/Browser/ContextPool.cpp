@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ContextPool.h"
+
+#include "InjectedBundleGlue.h"
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <iterator>
+#include <sstream>
+
+ContextPool::ContextPool(const std::string& bundlePath, InjectedBundleGlue* glue, int maxProcesses, bool processPerSite)
+    : m_bundlePath(bundlePath)
+    , m_glue(glue)
+    , m_maxProcesses(std::max(maxProcesses, 0))
+    , m_processPerSite(processPerSite)
+{
+}
+
+ContextPool::~ContextPool()
+{
+    for (Entry& entry : m_entries)
+        WKRelease(entry.context);
+}
+
+WKContextRef ContextPool::acquire(const std::string& url)
+{
+    const std::string site = m_processPerSite ? registrableDomain(url) : std::string();
+    Entry* chosen = 0;
+
+    if (!site.empty()) {
+        for (Entry& entry : m_entries) {
+            if (entry.site == site) {
+                chosen = &entry;
+                break;
+            }
+        }
+    }
+
+    // Contexts left without tabs are reused before creating new ones, their process may still be up.
+    if (!chosen) {
+        for (Entry& entry : m_entries) {
+            if (!entry.tabs) {
+                chosen = &entry;
+                chosen->site = site;
+                break;
+            }
+        }
+    }
+
+    if (!chosen && (!m_maxProcesses || m_entries.size() < m_maxProcesses))
+        chosen = createEntry(site);
+
+    if (!chosen) {
+        chosen = &*std::min_element(m_entries.begin(), m_entries.end(), [](const Entry& a, const Entry& b) {
+            return a.tabs < b.tabs;
+        });
+    }
+
+    ++chosen->tabs;
+    return chosen->context;
+}
+
+void ContextPool::addTab(WKContextRef context)
+{
+    Entry* entry = find(context);
+    assert(entry);
+    ++entry->tabs;
+}
+
+void ContextPool::removeTab(WKContextRef context)
+{
+    Entry* entry = find(context);
+    assert(entry && entry->tabs > 0);
+    --entry->tabs;
+
+    // Without a limit every tab gets a new context, so only one spare is kept around.
+    if (!entry->tabs && !m_maxProcesses) {
+        size_t spares = std::count_if(m_entries.begin(), m_entries.end(), [](const Entry& e) { return !e.tabs; });
+        if (spares > 1) {
+            WKRelease(entry->context);
+            m_entries.erase(m_entries.begin() + (entry - &m_entries[0]));
+        }
+    }
+}
+
+void ContextPool::releaseUnusedContexts()
+{
+    for (size_t i = 0; i < m_entries.size(); ) {
+        if (m_entries[i].tabs) {
+            ++i;
+            continue;
+        }
+        WKRelease(m_entries[i].context);
+        m_entries.erase(m_entries.begin() + i);
+    }
+}
+
+ContextPool::Entry* ContextPool::find(WKContextRef context)
+{
+    for (Entry& entry : m_entries) {
+        if (entry.context == context)
+            return &entry;
+    }
+    return 0;
+}
+
+ContextPool::Entry* ContextPool::createEntry(const std::string& site)
+{
+    WKStringRef path = WKStringCreateWithUTF8CString(m_bundlePath.c_str());
+    Entry entry = { WKContextCreateWithInjectedBundlePath(path), 0, site };
+    WKRelease(path);
+    m_glue->attach(entry.context);
+    m_entries.push_back(entry);
+    return &m_entries.back();
+}
+
+std::string ContextPool::stats() const
+{
+    std::ostringstream out;
+    out << m_entries.size() << " web processes, tabs per process:";
+    for (const Entry& entry : m_entries) {
+        out << ' ' << entry.tabs;
+        if (!entry.site.empty())
+            out << " (" << entry.site << ')';
+    }
+    return out.str();
+}
+
+static bool isNumericHost(const std::string& host)
+{
+    return host.find_first_not_of("0123456789.") == std::string::npos || host[0] == '[';
+}
+
+std::string ContextPool::registrableDomain(const std::string& url)
+{
+    size_t schemeEnd = url.find("://");
+    if (schemeEnd == std::string::npos)
+        return std::string();
+
+    size_t hostStart = schemeEnd + 3;
+    size_t hostEnd = url.find_first_of("/?#", hostStart);
+    std::string host = url.substr(hostStart, hostEnd == std::string::npos ? std::string::npos : hostEnd - hostStart);
+    size_t userInfoEnd = host.rfind('@');
+    if (userInfoEnd != std::string::npos)
+        host.erase(0, userInfoEnd + 1);
+    if (host.empty())
+        return std::string();
+    if (host[0] == '[') {
+        // IPv6 addresses have colons of their own, the port comes after the closing bracket.
+        size_t addressEnd = host.find(']');
+        if (addressEnd != std::string::npos)
+            host.erase(addressEnd + 1);
+    } else {
+        size_t portStart = host.rfind(':');
+        if (portStart != std::string::npos)
+            host.erase(portStart);
+    }
+    std::transform(host.begin(), host.end(), host.begin(), ::tolower);
+    if (isNumericHost(host))
+        return host;
+
+    std::vector<std::string> labels;
+    std::istringstream stream(host);
+    std::string label;
+    while (std::getline(stream, label, '.'))
+        labels.push_back(label);
+    if (labels.size() <= 2)
+        return host;
+
+    // Without the public suffix list, guess that the usual generic labels under a country code
+    // are part of the suffix, like in co.uk or com.br, but not in ibm.de.
+    static const char* const secondLevelSuffixes[] = { "ac", "co", "com", "edu", "gob", "gov", "ltd", "mil", "ne", "net", "or", "org", "plc", "sch" };
+    size_t suffixLabels = 1;
+    const std::string& secondLevel = labels[labels.size() - 2];
+    if (labels.back().size() == 2 && std::find(std::begin(secondLevelSuffixes), std::end(secondLevelSuffixes), secondLevel) != std::end(secondLevelSuffixes))
+        suffixLabels = 2;
+
+    std::string domain;
+    for (size_t i = labels.size() - suffixLabels - 1; i < labels.size(); ++i)
+        domain += (domain.empty() ? "" : ".") + labels[i];
+    return domain;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ContextPool_h
+#define ContextPool_h
+
+#include <WebKit2/WKContext.h>
+#include <string>
+#include <vector>
+
+class InjectedBundleGlue;
+
+// Each WKContext runs its pages in its own web process, with its own injected bundle. The pool
+// shares contexts between tabs so there are at most maxProcesses of them, 0 meaning one per tab.
+// With processPerSite, tabs opened for a URL share the context of other tabs of the same site.
+class ContextPool
+{
+public:
+    ContextPool(const std::string& bundlePath, InjectedBundleGlue*, int maxProcesses, bool processPerSite);
+    ~ContextPool();
+
+    // Returns the context for a new tab, the URL may be empty if it's not known yet.
+    WKContextRef acquire(const std::string& url);
+    // For tabs sharing the context of another tab, like popups.
+    void addTab(WKContextRef);
+    void removeTab(WKContextRef);
+    // Drops the contexts without tabs, ending their web processes.
+    void releaseUnusedContexts();
+
+    size_t processCount() const { return m_entries.size(); }
+    // One line with the number of tabs each process hosts.
+    std::string stats() const;
+
+    // Site for the process per site policy: the host without subdomains.
+    static std::string registrableDomain(const std::string& url);
+
+private:
+    struct Entry {
+        WKContextRef context;
+        int tabs;
+        // Tabs of other sites may land here once all processes are in use.
+        std::string site;
+    };
+
+    std::string m_bundlePath;
+    InjectedBundleGlue* m_glue;
+    size_t m_maxProcesses;
+    bool m_processPerSite;
+    std::vector<Entry> m_entries;
+
+    Entry* find(WKContextRef);
+    Entry* createEntry(const std::string& site);
+};
+
+#endif
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "CrashBackoff.h"
+
+#include <algorithm>
+#include <glib.h>
+
+static const int initialDelayMilliseconds = 500;
+static const int maxDelayMilliseconds = 30 * 1000;
+static const int64_t crashesInARowInterval = 5 * 60 * G_USEC_PER_SEC;
+
+CrashBackoff::CrashBackoff(int maxCrashes)
+    : m_maxCrashes(maxCrashes)
+    , m_crashes(0)
+    , m_lastCrash(0)
+{
+}
+
+int CrashBackoff::crashed()
+{
+    int64_t now = g_get_monotonic_time();
+    if (m_crashes && now - m_lastCrash > crashesInARowInterval)
+        m_crashes = 0;
+    m_lastCrash = now;
+    ++m_crashes;
+
+    if (m_maxCrashes && m_crashes > m_maxCrashes)
+        return -1;
+    int delay = initialDelayMilliseconds;
+    for (int i = 1; i < m_crashes && delay < maxDelayMilliseconds; ++i)
+        delay *= 2;
+    return std::min(delay, maxDelayMilliseconds);
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "DamageRegion.h"
+
+#include <algorithm>
+#include <cmath>
+
+static WKRect enclosingIntRect(const WKRect& rect)
+{
+    double left = std::floor(rect.origin.x);
+    double top = std::floor(rect.origin.y);
+    double right = std::ceil(rect.origin.x + rect.size.width);
+    double bottom = std::ceil(rect.origin.y + rect.size.height);
+    return WKRectMake(left, top, right - left, bottom - top);
+}
+
+DamageRegion::DamageRegion()
+    : m_rect(WKRectMake(0, 0, 0, 0))
+{
+}
+
+DamageRegion::DamageRegion(const WKRect& rect)
+    : m_rect(WKRectMake(0, 0, 0, 0))
+{
+    unite(rect);
+}
+
+void DamageRegion::unite(const WKRect& rect)
+{
+    if (rect.size.width <= 0 || rect.size.height <= 0)
+        return;
+
+    WKRect other = enclosingIntRect(rect);
+    if (isEmpty()) {
+        m_rect = other;
+        return;
+    }
+
+    double left = std::min(m_rect.origin.x, other.origin.x);
+    double top = std::min(m_rect.origin.y, other.origin.y);
+    double right = std::max(m_rect.origin.x + m_rect.size.width, other.origin.x + other.size.width);
+    double bottom = std::max(m_rect.origin.y + m_rect.size.height, other.origin.y + other.size.height);
+    m_rect = WKRectMake(left, top, right - left, bottom - top);
+}
+
+void DamageRegion::intersect(const WKRect& rect)
+{
+    WKRect other = enclosingIntRect(rect);
+    double left = std::max(m_rect.origin.x, other.origin.x);
+    double top = std::max(m_rect.origin.y, other.origin.y);
+    double right = std::min(m_rect.origin.x + m_rect.size.width, other.origin.x + other.size.width);
+    double bottom = std::min(m_rect.origin.y + m_rect.size.height, other.origin.y + other.size.height);
+    if (right <= left || bottom <= top)
+        clear();
+    else
+        m_rect = WKRectMake(left, top, right - left, bottom - top);
+}
+
+bool DamageRegion::intersects(const WKRect& rect) const
+{
+    DamageRegion intersection(*this);
+    intersection.intersect(rect);
+    return !intersection.isEmpty();
+}
+
+void DamageRegion::clear()
+{
+    m_rect = WKRectMake(0, 0, 0, 0);
+}
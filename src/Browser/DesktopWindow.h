@@ -28,6 +28,8 @@
 
 #include <WebKit2/WKGeometry.h>
 #include <NIXEvents.h>
+#include <stdint.h>
+#include <string>
 
 class DesktopWindowClient
 {
@@ -41,6 +43,8 @@ public:
     virtual void onMouseWheel(NIXWheelEvent*) = 0;
 
     virtual void onWindowSizeChange(WKSize) = 0;
+    // The window was minimized, unmapped or fully covered by other windows, or is shown again.
+    virtual void onWindowVisibilityChange(bool visible) = 0;
     virtual void onWindowClose() = 0;
 };
 
@@ -55,14 +59,39 @@ public:
 
     virtual ~DesktopWindow();
 
-    static DesktopWindow* create(DesktopWindowClient* client, int width, int height);
+    // A full screen window ignores the size, covers the whole screen and asks the compositor to
+    // unredirect it, so frames go straight to the screen.
+    static DesktopWindow* create(DesktopWindowClient* client, int width, int height, bool fullScreen = false);
+    // Renders offscreen without a window system, input is read from inputScript if not empty.
+    static DesktopWindow* createHeadless(DesktopWindowClient* client, int width, int height, const std::string& inputScript);
 
     WKSize size() const { return m_size; }
 
     virtual void setMouseCursor(MouseCursor) = 0;
 
+    // The GL context is used from the render thread, see RenderThread.
     virtual void makeCurrent() = 0;
+    virtual void doneCurrent() = 0;
     virtual void swapBuffers() = 0;
+
+    // Delivers the window system events already queued to the client, so they are handled before painting.
+    virtual void dispatchPendingEvents() = 0;
+
+    // Gets the monotonic time (in microseconds) of the last vertical blank and the refresh interval.
+    // Returns false if the platform can't tell. Called from the main thread while rendering goes on.
+    virtual bool vsyncTiming(int64_t* lastVBlank, int64_t* refreshInterval) = 0;
+    // False when rendering offscreen, there's no refresh rate to keep frames under then.
+    virtual bool hasDisplay() const = 0;
+
+    // Number of frames since the back buffer contents were drawn, 0 if they are undefined.
+    // Returns -1 if the platform can't tell.
+    virtual int backBufferAge() = 0;
+
+    // Copies a rect of the back buffer to the front buffer, keeping the back buffer contents, so it
+    // can be used instead of swapBuffers() when only part of the window changed. Called on the
+    // render thread, windowSize is the size the frame was painted at.
+    virtual bool canCopySubBuffer() const = 0;
+    virtual void copySubBuffer(const WKRect&, const WKSize& windowSize) = 0;
 protected:
     DesktopWindowClient* m_client;
     WKSize m_size;
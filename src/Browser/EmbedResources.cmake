@@ -0,0 +1,22 @@
+# Writes OUTPUT, a C++ source with every file of the UI in SOURCE_DIR as a byte array, listed in
+# the uiResources table declared in UiResources.h. Run with cmake -P at build time.
+
+file(GLOB_RECURSE files RELATIVE "${SOURCE_DIR}" "${SOURCE_DIR}/*.html" "${SOURCE_DIR}/*.css" "${SOURCE_DIR}/*.js" "${SOURCE_DIR}/*.png")
+list(SORT files)
+
+set(source "// Generated by EmbedResources.cmake, don't edit.\n\n#include \"UiResources.h\"\n\n")
+set(table "")
+set(index 0)
+foreach(name ${files})
+  file(READ "${SOURCE_DIR}/${name}" hex HEX)
+  string(LENGTH "${hex}" length)
+  math(EXPR size "${length} / 2")
+  string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+  # The extra 0 keeps arrays of empty files valid.
+  set(source "${source}static const unsigned char resource${index}[] = { ${bytes} 0 };\n")
+  set(table "${table}    { \"${name}\", resource${index}, ${size} },\n")
+  math(EXPR index "${index} + 1")
+endforeach()
+
+set(source "${source}\nconst UiResource uiResources[] = {\n${table}    { 0, 0, 0 }\n};\n")
+file(WRITE "${OUTPUT}" "${source}")
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "FrameClock.h"
+
+#include "DesktopWindow.h"
+#include <algorithm>
+#include <cassert>
+
+// Used when the platform can't tell us the display refresh rate, but there is a display.
+static const int64_t fallbackFrameInterval = G_USEC_PER_SEC / 60;
+
+// Same as GDK_PRIORITY_REDRAW, so input and IPC sources get dispatched before painting.
+static const gint frameSourcePriority = G_PRIORITY_HIGH_IDLE + 20;
+
+struct FrameClockSource {
+    GSource source;
+    FrameClock* frameClock;
+
+    bool frameRequested() const { return frameClock->m_frameRequested && !frameClock->m_paused; }
+    int64_t targetTime() const { return frameClock->m_targetTime; }
+    void dispatchFrame() { frameClock->dispatchFrame(); }
+};
+
+static gboolean frameSourceCheck(GSource* source)
+{
+    FrameClockSource* frameSource = reinterpret_cast<FrameClockSource*>(source);
+    return frameSource->frameRequested() && g_get_monotonic_time() >= frameSource->targetTime();
+}
+
+static gboolean frameSourcePrepare(GSource* source, gint* timeout)
+{
+    FrameClockSource* frameSource = reinterpret_cast<FrameClockSource*>(source);
+    if (!frameSource->frameRequested()) {
+        *timeout = -1;
+        return false;
+    }
+
+    int64_t remaining = frameSource->targetTime() - g_get_monotonic_time();
+    if (remaining <= 0) {
+        *timeout = 0;
+        return true;
+    }
+    *timeout = (remaining + 999) / 1000;
+    return false;
+}
+
+static gboolean frameSourceDispatch(GSource* source, GSourceFunc, gpointer)
+{
+    reinterpret_cast<FrameClockSource*>(source)->dispatchFrame();
+    return true;
+}
+
+static GSourceFuncs frameSourceFuncs = {
+    frameSourcePrepare,
+    frameSourceCheck,
+    frameSourceDispatch,
+    0
+};
+
+FrameClock::FrameClock(DesktopWindow* window, Client* client)
+    : m_window(window)
+    , m_client(client)
+    , m_source(0)
+    , m_frameRequested(false)
+    , m_paused(false)
+    , m_maxFramesPerSecond(0)
+    , m_minFrameInterval(0)
+    , m_lastFrameTime(0)
+    , m_targetTime(0)
+{
+    assert(window);
+    assert(client);
+
+    m_source = reinterpret_cast<FrameClockSource*>(g_source_new(&frameSourceFuncs, sizeof(FrameClockSource)));
+    m_source->frameClock = this;
+
+    g_source_set_priority(&m_source->source, frameSourcePriority);
+    g_source_attach(&m_source->source, 0);
+}
+
+FrameClock::~FrameClock()
+{
+    g_source_destroy(&m_source->source);
+    g_source_unref(&m_source->source);
+}
+
+void FrameClock::setMaxFramesPerSecond(int fps)
+{
+    m_maxFramesPerSecond = std::max(fps, 0);
+    m_minFrameInterval = m_maxFramesPerSecond ? G_USEC_PER_SEC / m_maxFramesPerSecond : 0;
+    if (m_frameRequested)
+        m_targetTime = computeTargetTime(g_get_monotonic_time());
+}
+
+void FrameClock::setPaused(bool paused)
+{
+    if (paused == m_paused)
+        return;
+
+    m_paused = paused;
+    if (!m_paused && m_frameRequested)
+        m_targetTime = computeTargetTime(g_get_monotonic_time());
+}
+
+void FrameClock::requestFrame()
+{
+    if (m_frameRequested)
+        return;
+
+    m_frameRequested = true;
+    m_targetTime = computeTargetTime(g_get_monotonic_time());
+}
+
+int64_t FrameClock::computeTargetTime(int64_t now) const
+{
+    int64_t lastVBlank;
+    int64_t refreshInterval;
+    if (!m_window->vsyncTiming(&lastVBlank, &refreshInterval) || refreshInterval <= 0) {
+        int64_t interval = m_window->hasDisplay() ? std::max(m_minFrameInterval, fallbackFrameInterval) : m_minFrameInterval;
+        return std::max(now, m_lastFrameTime + interval);
+    }
+
+    // Paint on the first vertical blank after the last frame that also respects the fps cap,
+    // so every refresh gets at most one frame and the swap has a whole refresh to land.
+    int64_t earliest = std::max(m_lastFrameTime + 1, m_lastFrameTime + m_minFrameInterval);
+    if (lastVBlank >= earliest)
+        return lastVBlank;
+    int64_t refreshes = (earliest - lastVBlank + refreshInterval - 1) / refreshInterval;
+    return lastVBlank + refreshes * refreshInterval;
+}
+
+void FrameClock::dispatchFrame()
+{
+    // Requests done while painting belong to the next frame.
+    m_frameRequested = false;
+    m_lastFrameTime = g_get_monotonic_time();
+    m_client->onFrame();
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FrameClock_h
+#define FrameClock_h
+
+#include <glib.h>
+#include <stdint.h>
+
+class DesktopWindow;
+struct FrameClockSource;
+
+// Paces display updates to the display refresh, using a GSource on the default main context.
+// The vertical blank timing comes from the DesktopWindow when the platform exposes it, otherwise
+// frames are spaced by a plain monotonic timer.
+class FrameClock {
+public:
+    class Client {
+    public:
+        virtual void onFrame() = 0;
+    };
+
+    FrameClock(DesktopWindow*, Client*);
+    ~FrameClock();
+
+    // Asks for Client::onFrame to be called on the next frame, multiple requests are coalesced.
+    void requestFrame();
+
+    // While paused frame requests are kept, but only dispatched after resuming.
+    void setPaused(bool);
+    bool isPaused() const { return m_paused; }
+
+    // 0 means no cap other than the display refresh rate.
+    void setMaxFramesPerSecond(int);
+    int maxFramesPerSecond() const { return m_maxFramesPerSecond; }
+
+private:
+    friend struct FrameClockSource;
+
+    DesktopWindow* m_window;
+    Client* m_client;
+    FrameClockSource* m_source;
+
+    bool m_frameRequested;
+    bool m_paused;
+    int m_maxFramesPerSecond;
+    int64_t m_minFrameInterval;
+    int64_t m_lastFrameTime;
+    int64_t m_targetTime;
+
+    int64_t computeTargetTime(int64_t now) const;
+    void dispatchFrame();
+};
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FrameTimings_h
+#define FrameTimings_h
+
+#include "RingBuffer.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// CPU side durations of a frame, in microseconds. GL work may still be queued when the paint
+// calls return, in which case it shows up in the swap time.
+struct FrameTiming
+{
+    int64_t start;
+    // Time since the previous frame started, 0 for the first frame.
+    int64_t interval;
+    int64_t uiPaint;
+    int64_t contentsPaint;
+    int64_t swap;
+};
+
+class FrameTimings
+{
+public:
+    static const size_t capacity = 8192;
+
+    void add(const FrameTiming& timing) { m_samples.push(timing); }
+    std::vector<FrameTiming> last(size_t count = capacity) const { return m_samples.last(count); }
+    size_t totalFrames() const { return m_samples.totalPushed(); }
+
+    // Nearest rank percentile, percentile goes from 0 to 100.
+    static int64_t percentile(std::vector<int64_t> values, double percentile);
+
+    // Writes the kept samples as CSV, returns false on I/O errors.
+    bool writeToFile(const std::string& path) const;
+
+private:
+    RingBuffer<FrameTiming, capacity> m_samples;
+};
+
+#endif
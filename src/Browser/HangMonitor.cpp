@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "HangMonitor.h"
+
+#include <cassert>
+#include <iostream>
+
+static const guint pingIntervalMilliseconds = 2000;
+static const int64_t pingInterval = pingIntervalMilliseconds * 1000;
+
+static const char* outcomeName(int outcome)
+{
+    static const char* names[] = { "recovered", "killed", "crashed" };
+    return names[outcome];
+}
+
+HangMonitor::HangMonitor(Client* client, int timeoutSeconds, ResourceMonitor* resourceMonitor)
+    : m_client(client)
+    , m_timeout(int64_t(timeoutSeconds) * G_USEC_PER_SEC)
+    , m_resourceMonitor(resourceMonitor)
+    , m_timer(timeoutSeconds ? g_timeout_add(pingIntervalMilliseconds, checkCallback, this) : 0)
+    , m_lastCheck(g_get_monotonic_time())
+{
+    assert(client);
+    assert(resourceMonitor);
+}
+
+HangMonitor::~HangMonitor()
+{
+    if (m_timer)
+        g_source_remove(m_timer);
+}
+
+gboolean HangMonitor::checkCallback(gpointer data)
+{
+    static_cast<HangMonitor*>(data)->check();
+    return true;
+}
+
+void HangMonitor::check()
+{
+    int64_t now = g_get_monotonic_time();
+    bool late = now - m_lastCheck > 2 * pingInterval;
+    m_lastCheck = now;
+
+    // Closed and discarded tabs are dropped here.
+    std::map<int, Watch> watches;
+    for (const ResourceMonitor::TabProcess& tab : m_client->tabProcesses()) {
+        if (tab.pid <= 0)
+            continue;
+        std::map<int, Watch>::const_iterator watch = m_watches.find(tab.tabId);
+        if (watch != m_watches.end() && watch->second.pid == tab.pid) {
+            watches[tab.tabId] = watch->second;
+        } else {
+            Watch newWatch = { tab.pid, 0, 0, false };
+            watches[tab.tabId] = newWatch;
+        }
+    }
+    m_watches.swap(watches);
+
+    std::vector<int> hungTabs;
+    for (std::pair<const int, Watch>& p : m_watches) {
+        Watch& watch = p.second;
+        // The browser itself stalled or the machine was suspended, the pongs may be queued
+        // behind this timer, so the pings are timed again from now.
+        if (late) {
+            if (watch.pingSent)
+                watch.pingSent = now;
+            continue;
+        }
+        updateHang(p.first, watch, now);
+        if (watch.hangStart && now - watch.hangStart >= m_timeout) {
+            hungTabs.push_back(p.first);
+            continue;
+        }
+        // Only one ping at a time, they'd pile up in a hung process.
+        if (!watch.pingSent) {
+            watch.pingSent = now;
+            m_client->pingTab(p.first);
+        }
+    }
+
+    // Tabs sharing the process hang together, all of them are reloaded.
+    for (int tabId : hungTabs) {
+        // Killing another tab of the process may have ended this hang as a crash already.
+        std::map<int, Watch>::iterator watch = m_watches.find(tabId);
+        if (watch == m_watches.end())
+            continue;
+        std::cerr << "Tab " << tabId << " hung for " << (now - watch->second.hangStart) / 1000 << " ms, terminating its web process" << std::endl;
+        endHang(tabId, watch->second, now, Killed);
+        m_watches.erase(watch);
+        m_client->killTab(tabId);
+    }
+}
+
+void HangMonitor::updateHang(int tabId, Watch& watch, int64_t now)
+{
+    bool pingLate = watch.pingSent && now - watch.pingSent >= pingInterval;
+    if (!watch.hangStart && (pingLate || watch.unresponsive))
+        watch.hangStart = pingLate ? watch.pingSent : now;
+    else if (watch.hangStart && !pingLate && !watch.unresponsive)
+        endHang(tabId, watch, now, Recovered);
+}
+
+void HangMonitor::pong(int tabId)
+{
+    std::map<int, Watch>::iterator watch = m_watches.find(tabId);
+    if (watch == m_watches.end())
+        return;
+    watch->second.pingSent = 0;
+    updateHang(tabId, watch->second, g_get_monotonic_time());
+}
+
+void HangMonitor::tabUnresponsive(int tabId)
+{
+    std::map<int, Watch>::iterator watch = m_watches.find(tabId);
+    if (watch == m_watches.end())
+        return;
+    watch->second.unresponsive = true;
+    updateHang(tabId, watch->second, g_get_monotonic_time());
+}
+
+void HangMonitor::tabResponsive(int tabId)
+{
+    std::map<int, Watch>::iterator watch = m_watches.find(tabId);
+    if (watch == m_watches.end())
+        return;
+    watch->second.unresponsive = false;
+    updateHang(tabId, watch->second, g_get_monotonic_time());
+}
+
+void HangMonitor::tabCrashed(int tabId)
+{
+    std::map<int, Watch>::iterator watch = m_watches.find(tabId);
+    if (watch == m_watches.end())
+        return;
+    if (watch->second.hangStart)
+        endHang(tabId, watch->second, g_get_monotonic_time(), Crashed);
+    m_watches.erase(watch);
+}
+
+void HangMonitor::endHang(int tabId, Watch& watch, int64_t now, Outcome outcome)
+{
+    int64_t duration = now - watch.hangStart;
+    watch.hangStart = 0;
+    if (outcome != Killed)
+        std::cout << "Tab " << tabId << " was unresponsive for " << duration / 1000 << " ms, " << outcomeName(outcome) << std::endl;
+    m_resourceMonitor->logHang(tabId, watch.pid, duration / 1000, outcomeName(outcome));
+}
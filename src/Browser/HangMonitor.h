@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HangMonitor_h
+#define HangMonitor_h
+
+#include "ResourceMonitor.h"
+#include <glib.h>
+#include <map>
+#include <stdint.h>
+#include <sys/types.h>
+#include <vector>
+
+// Finds tabs whose web process stopped answering, either because WebKit says so or because the
+// injected bundle didn't answer a ping, and has their process terminated once the hang lasts for
+// the timeout. Pings are answered on the main thread of the web process, where scripts run, so a
+// page stuck in a loop can't answer them.
+class HangMonitor
+{
+public:
+    class Client {
+    public:
+        // Tabs with a pid of 0 have no process to watch.
+        virtual std::vector<ResourceMonitor::TabProcess> tabProcesses() = 0;
+        // The injected bundle of the tab should send back a pong, see pong().
+        virtual void pingTab(int tabId) = 0;
+        // The tab hung for the whole timeout, its web process should be terminated.
+        virtual void killTab(int tabId) = 0;
+    };
+
+    // A timeout of 0 disables the monitor. Every hang is also written to the resource log.
+    HangMonitor(Client*, int timeoutSeconds, ResourceMonitor*);
+    ~HangMonitor();
+
+    void pong(int tabId);
+    // What WebKit tells after input events or messages to the web process go unanswered.
+    void tabUnresponsive(int tabId);
+    void tabResponsive(int tabId);
+    // A hang ends when the process goes away.
+    void tabCrashed(int tabId);
+
+private:
+    enum Outcome {
+        Recovered,
+        Killed,
+        Crashed
+    };
+
+    struct Watch {
+        // A new process starts over with a new watch.
+        pid_t pid;
+        // Of the ping not answered yet, 0 if none.
+        int64_t pingSent;
+        // Monotonic time the tab stopped answering, 0 if it's responsive.
+        int64_t hangStart;
+        bool unresponsive;
+    };
+
+    Client* m_client;
+    int64_t m_timeout;
+    ResourceMonitor* m_resourceMonitor;
+    std::map<int, Watch> m_watches;
+    guint m_timer;
+    int64_t m_lastCheck;
+
+    void check();
+    void updateHang(int tabId, Watch&, int64_t now);
+    void endHang(int tabId, Watch&, int64_t now, Outcome);
+    static gboolean checkCallback(gpointer);
+};
+
+#endif
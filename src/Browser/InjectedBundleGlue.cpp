@@ -43,6 +43,11 @@ static void didReceiveMessageFromInjectedBundle(WKContextRef page, WKStringRef m
 }
 
 InjectedBundleGlue::InjectedBundleGlue(WKContextRef context)
+{
+    attach(context);
+}
+
+void InjectedBundleGlue::attach(WKContextRef context)
 {
     WKContextInjectedBundleClient bundleClient;
     std::memset(&bundleClient, 0, sizeof(bundleClient));
@@ -38,13 +38,15 @@
 inline WKTypeRef createArg() { return 0; }
 inline WKTypeRef createArg(const WKTypeRef& value) { return value; }
 
-inline void _nop(...) {}
-
+// The items are packed last first, the UI bundle reads them in reverse order.
 template<typename ... T>
 WKTypeRef createArg(WKTypeRef first, T...t)
 {
+    // Unlike function arguments, the elements of a braced list are evaluated in order.
+    WKTypeRef rest[] = { t... };
     WKMutableArrayRef pack = WKMutableArrayCreate();
-    _nop((WKArrayAppendItem(pack, t), 1)...);
+    for (size_t i = sizeof...(t); i; --i)
+        WKArrayAppendItem(pack, rest[i - 1]);
     WKArrayAppendItem(pack, first);
     return pack;
 }
@@ -60,8 +62,12 @@ static void postToBundle(WKPageRef page, const char* message, const T& ... value
 class InjectedBundleGlue
 {
 public:
+    InjectedBundleGlue() { }
     InjectedBundleGlue(WKContextRef);
 
+    // Also receive the messages of the given context, the glue must outlive it.
+    void attach(WKContextRef);
+
     template<typename Return, typename Obj, typename Param>
     void bind(const char* messageName, Obj* obj, Return (Obj::*method)(const Param&))
     {
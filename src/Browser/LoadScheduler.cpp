@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "LoadScheduler.h"
+
+#include "Tab.h"
+#include <algorithm>
+
+LoadScheduler::LoadScheduler(int maxLoads)
+    : m_maxLoads(std::max(maxLoads, 0))
+    , m_startSource(0)
+{
+}
+
+LoadScheduler::~LoadScheduler()
+{
+    if (m_startSource)
+        g_source_remove(m_startSource);
+}
+
+void LoadScheduler::load(Tab* tab, const std::string& url, bool foreground)
+{
+    load(tab, [tab, url] { tab->loadUrl(url); }, foreground);
+}
+
+void LoadScheduler::load(Tab* tab, const Load& load, bool foreground)
+{
+    cancel(tab);
+    if (foreground) {
+        load();
+        return;
+    }
+
+    QueuedLoad queuedLoad = { tab, load };
+    m_queue.push_back(queuedLoad);
+    // Background loads start from the main loop, after the foreground loads asked for meanwhile.
+    scheduleStart();
+}
+
+void LoadScheduler::loadFinished(Tab* tab)
+{
+    if (m_loading.erase(tab))
+        scheduleStart();
+}
+
+void LoadScheduler::tabSelected(Tab* tab)
+{
+    if (m_loading.erase(tab))
+        scheduleStart();
+
+    for (std::deque<QueuedLoad>::iterator it = m_queue.begin(); it != m_queue.end(); ++it) {
+        if (it->tab == tab) {
+            Load load = it->load;
+            m_queue.erase(it);
+            load();
+            return;
+        }
+    }
+}
+
+void LoadScheduler::cancel(Tab* tab)
+{
+    m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(), [tab](const QueuedLoad& load) { return load.tab == tab; }), m_queue.end());
+    if (m_loading.erase(tab))
+        scheduleStart();
+}
+
+void LoadScheduler::start(Tab* tab, const Load& load)
+{
+    // Inserted first, loads that can't start call loadFinished() right away.
+    m_loading.insert(tab);
+    load();
+}
+
+void LoadScheduler::scheduleStart()
+{
+    if (!m_startSource && !m_queue.empty())
+        m_startSource = g_idle_add(startCallback, this);
+}
+
+gboolean LoadScheduler::startCallback(gpointer data)
+{
+    LoadScheduler* self = static_cast<LoadScheduler*>(data);
+    self->m_startSource = 0;
+    while (!self->m_queue.empty() && (!self->m_maxLoads || self->m_loading.size() < self->m_maxLoads)) {
+        QueuedLoad load = self->m_queue.front();
+        self->m_queue.pop_front();
+        self->start(load.tab, load.load);
+    }
+    return false;
+}
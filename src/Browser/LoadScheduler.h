@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LoadScheduler_h
+#define LoadScheduler_h
+
+#include <deque>
+#include <functional>
+#include <glib.h>
+#include <set>
+#include <string>
+
+class Tab;
+
+// Limits how many background tabs load at once. Loads for the tab the user is looking at start
+// right away and don't take a slot, background loads wait in order for a free slot or for their
+// tab to be selected. Loads started by the pages themselves, like clicked links, aren't counted.
+class LoadScheduler
+{
+public:
+    // Starts loading the tab, a URL or a restored session.
+    typedef std::function<void()> Load;
+
+    // 0 doesn't limit loads.
+    explicit LoadScheduler(int maxLoads);
+    ~LoadScheduler();
+
+    void load(Tab*, const std::string& url, bool foreground);
+    void load(Tab*, const Load&, bool foreground);
+    // Frees the slot of the tab, also when its load failed.
+    void loadFinished(Tab*);
+    // Starts the queued load of the tab, if any, a selected tab no longer takes a slot.
+    void tabSelected(Tab*);
+    // Forgets the loads of a tab that's going away.
+    void cancel(Tab*);
+
+    size_t queuedLoads() const { return m_queue.size(); }
+
+private:
+    struct QueuedLoad {
+        Tab* tab;
+        Load load;
+    };
+
+    size_t m_maxLoads;
+    std::deque<QueuedLoad> m_queue;
+    std::set<Tab*> m_loading;
+    guint m_startSource;
+
+    void start(Tab*, const Load&);
+    void scheduleStart();
+    static gboolean startCallback(gpointer);
+};
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "MemoryPressureMonitor.h"
+
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+
+static const guint pollIntervalMilliseconds = 2000;
+// Share of the time between polls some task of the cgroup waited for memory. Not the avg10 field,
+// which stays high for several polls after the memory was freed.
+static const double stallThresholdPercent = 10;
+
+// The cgroup v2 the process is in, from the "0::/path" line of /proc/self/cgroup.
+static std::string findPressureFile()
+{
+    std::ifstream cgroups("/proc/self/cgroup");
+    std::string line;
+    while (std::getline(cgroups, line)) {
+        if (line.compare(0, 3, "0::"))
+            continue;
+        std::string path = "/sys/fs/cgroup" + line.substr(3) + "/memory.pressure";
+        if (std::ifstream(path.c_str()))
+            return path;
+    }
+    return std::string();
+}
+
+// In kB, -1 if unknown.
+static long availableMemory()
+{
+    std::ifstream meminfo("/proc/meminfo");
+    std::string line;
+    while (std::getline(meminfo, line)) {
+        long value;
+        if (sscanf(line.c_str(), "MemAvailable: %ld kB", &value) == 1)
+            return value;
+    }
+    return -1;
+}
+
+// The "some total" field, in microseconds, -1 if unknown.
+static int64_t memoryStallTotal(const std::string& pressureFile)
+{
+    std::ifstream pressure(pressureFile.c_str());
+    std::string line;
+    while (std::getline(pressure, line)) {
+        long long value;
+        if (sscanf(line.c_str(), "some avg10=%*f avg60=%*f avg300=%*f total=%lld", &value) == 1)
+            return value;
+    }
+    return -1;
+}
+
+MemoryPressureMonitor::MemoryPressureMonitor(Client* client, int availableThresholdMegabytes)
+    : m_client(client)
+    , m_availableThreshold(long(availableThresholdMegabytes) * 1024)
+    , m_pressureFile(findPressureFile())
+    , m_timer(0)
+    , m_lastStallTotal(-1)
+    , m_lastPoll(0)
+    , m_stallPercent(0)
+{
+    assert(client);
+    updateStall();
+    if (m_availableThreshold)
+        m_timer = g_timeout_add(pollIntervalMilliseconds, pollCallback, this);
+}
+
+MemoryPressureMonitor::~MemoryPressureMonitor()
+{
+    if (m_timer)
+        g_source_remove(m_timer);
+}
+
+bool MemoryPressureMonitor::isUnderPressure()
+{
+    if (!m_availableThreshold)
+        return false;
+
+    // Stalls also catch cgroup limits, which MemAvailable knows nothing about.
+    if (m_stallPercent >= stallThresholdPercent)
+        return true;
+    long available = availableMemory();
+    return available >= 0 && available < m_availableThreshold;
+}
+
+void MemoryPressureMonitor::updateStall()
+{
+    if (m_pressureFile.empty())
+        return;
+
+    int64_t now = g_get_monotonic_time();
+    int64_t total = memoryStallTotal(m_pressureFile);
+    if (total >= 0 && m_lastStallTotal >= 0 && now > m_lastPoll)
+        m_stallPercent = 100.0 * (total - m_lastStallTotal) / (now - m_lastPoll);
+    else
+        m_stallPercent = 0;
+    m_lastStallTotal = total;
+    m_lastPoll = now;
+}
+
+gboolean MemoryPressureMonitor::pollCallback(gpointer data)
+{
+    MemoryPressureMonitor* self = static_cast<MemoryPressureMonitor*>(data);
+    self->updateStall();
+    if (self->isUnderPressure())
+        self->m_client->onMemoryPressure();
+    return true;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MemoryPressureMonitor_h
+#define MemoryPressureMonitor_h
+
+#include <glib.h>
+#include <stdint.h>
+#include <string>
+
+// Polls how much memory is left and tells the client while it's running low. Uses the
+// pressure stall information of the browser's cgroup when available, /proc/meminfo otherwise.
+class MemoryPressureMonitor
+{
+public:
+    class Client {
+    public:
+        // Called on every poll while under pressure, until the client frees enough memory.
+        virtual void onMemoryPressure() = 0;
+    };
+
+    // A threshold of 0 disables the monitor.
+    MemoryPressureMonitor(Client*, int availableThresholdMegabytes);
+    ~MemoryPressureMonitor();
+
+    bool isUnderPressure();
+
+private:
+    Client* m_client;
+    long m_availableThreshold;
+    std::string m_pressureFile;
+    guint m_timer;
+
+    // The stall counter at the last poll, -1 if unknown, and the share of the time since the
+    // previous poll some task waited for memory.
+    int64_t m_lastStallTotal;
+    int64_t m_lastPoll;
+    double m_stallPercent;
+
+    void updateStall();
+    static gboolean pollCallback(gpointer);
+};
+
+#endif
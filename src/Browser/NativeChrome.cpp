@@ -0,0 +1,500 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "NativeChrome.h"
+
+#include "Browser.h"
+#include "Tab.h"
+#include <algorithm>
+#include <cairo.h>
+#include <cmath>
+
+static const int tabBarHeight = 28;
+static const int toolBarHeight = 36;
+static const int maxTabWidth = 200;
+static const int minTabWidth = 48;
+static const int plusWidth = 28;
+static const int closeSize = 16;
+static const int buttonSize = 28;
+static const int buttonCount = 3;
+static const int urlFieldLeft = 4 + buttonCount * (buttonSize + 4) + 4;
+static const int urlFieldHeight = 24;
+static const int progressHeight = 3;
+static const double fontSize = 12;
+// Tabs using more CPU than this are highlighted.
+static const double busyCpuPercent = 50;
+
+NativeChrome::NativeChrome(Browser* browser)
+    : m_browser(browser)
+    , m_currentTab(-1)
+    , m_urlFocused(false)
+    , m_urlSelected(false)
+    , m_width(0)
+{
+}
+
+int NativeChrome::height() const
+{
+    return tabBarHeight + toolBarHeight;
+}
+
+NativeChrome::TabItem* NativeChrome::findTab(int tabId)
+{
+    for (TabItem& tab : m_tabs) {
+        if (tab.id == tabId)
+            return &tab;
+    }
+    return 0;
+}
+
+int NativeChrome::tabWidth() const
+{
+    if (m_tabs.empty())
+        return maxTabWidth;
+    return std::max(minTabWidth, std::min(maxTabWidth, int(m_width - plusWidth) / int(m_tabs.size())));
+}
+
+void NativeChrome::update()
+{
+    m_browser->uiNeedsDisplay(WKRectMake(0, 0, m_browser->window()->size().width, height()));
+}
+
+void NativeChrome::tabAdded(int tabId, bool background)
+{
+    TabItem tab = { tabId, std::string(), std::string(), -1, false, false, false };
+    m_tabs.push_back(tab);
+    if (background)
+        update();
+    else
+        selectTab(tabId);
+}
+
+void NativeChrome::urlChanged(int tabId, const std::string& url)
+{
+    TabItem* tab = findTab(tabId);
+    if (!tab)
+        return;
+    tab->url = url;
+    tab->crashed = false;
+    // Don't overwrite what is being typed.
+    if (tabId == m_currentTab && !m_urlFocused)
+        m_urlText = url;
+    update();
+}
+
+void NativeChrome::titleChanged(int tabId, const std::string& title)
+{
+    TabItem* tab = findTab(tabId);
+    if (!tab)
+        return;
+    tab->title = title;
+    tab->crashed = false;
+    update();
+}
+
+void NativeChrome::progressStarted(int tabId)
+{
+    progressChanged(tabId, 0);
+}
+
+void NativeChrome::progressChanged(int tabId, double progress)
+{
+    TabItem* tab = findTab(tabId);
+    if (!tab)
+        return;
+    tab->progress = progress;
+    if (tabId == m_currentTab)
+        update();
+}
+
+void NativeChrome::progressFinished(int tabId)
+{
+    progressChanged(tabId, -1);
+}
+
+void NativeChrome::tabDiscarded(int tabId, bool discarded)
+{
+    if (TabItem* tab = findTab(tabId)) {
+        tab->discarded = discarded;
+        update();
+    }
+}
+
+void NativeChrome::tabCrashed(int tabId)
+{
+    if (TabItem* tab = findTab(tabId)) {
+        tab->crashed = true;
+        tab->progress = -1;
+        update();
+    }
+}
+
+void NativeChrome::tabResourceUsage(int tabId, double cpuPercent, double)
+{
+    TabItem* tab = findTab(tabId);
+    if (!tab || tab->busy == (cpuPercent >= busyCpuPercent))
+        return;
+    tab->busy = !tab->busy;
+    update();
+}
+
+void NativeChrome::selectTab(int tabId)
+{
+    TabItem* tab = findTab(tabId);
+    if (!tab)
+        return;
+
+    m_currentTab = tabId;
+    m_urlText = tab->url;
+    // Like a new tab of ui.html, an empty tab waits for a URL.
+    setUrlFocused(m_urlText.empty());
+    m_browser->setCurrentTab(tabId);
+    update();
+}
+
+void NativeChrome::closeTab(int tabId)
+{
+    size_t index = 0;
+    while (index < m_tabs.size() && m_tabs[index].id != tabId)
+        ++index;
+    if (index == m_tabs.size())
+        return;
+
+    m_tabs.erase(m_tabs.begin() + index);
+    // The browser has no current tab after closing one, the next one takes the place of a closed
+    // current tab.
+    int next = m_currentTab;
+    if (tabId == m_currentTab)
+        next = m_tabs.empty() ? -1 : m_tabs[std::min(index, m_tabs.size() - 1)].id;
+    m_currentTab = -1;
+
+    // Quits once the last tab is closed.
+    m_browser->closeTab(tabId);
+    if (next != -1)
+        selectTab(next);
+    update();
+}
+
+void NativeChrome::loadUrl()
+{
+    if (m_currentTab == -1 || m_urlText.empty())
+        return;
+    findTab(m_currentTab)->url = m_urlText;
+    setUrlFocused(false);
+    m_browser->loadUrlOnCurrentTab(m_urlText);
+}
+
+void NativeChrome::goBack()
+{
+    if (m_currentTab != -1)
+        m_browser->currentTab()->back();
+}
+
+void NativeChrome::goForward()
+{
+    if (m_currentTab != -1)
+        m_browser->currentTab()->forward();
+}
+
+void NativeChrome::reload()
+{
+    if (m_currentTab != -1)
+        m_browser->currentTab()->reload();
+}
+
+void NativeChrome::setUrlFocused(bool focused)
+{
+    if (focused == m_urlFocused)
+        return;
+    m_urlFocused = focused;
+    m_urlSelected = focused;
+    // Typing was abandoned.
+    if (!focused && m_currentTab != -1)
+        m_urlText = findTab(m_currentTab)->url;
+    update();
+}
+
+bool NativeChrome::mousePress(const NIXMouseEvent* event)
+{
+    int x = event->x;
+    int y = event->y;
+    if (y < tabBarHeight) {
+        size_t index = x / tabWidth();
+        if (index < m_tabs.size()) {
+            int tabRight = (index + 1) * tabWidth();
+            if (x >= tabRight - closeSize - 6)
+                closeTab(m_tabs[index].id);
+            else if (m_tabs[index].id != m_currentTab)
+                selectTab(m_tabs[index].id);
+        } else if (x < int(m_tabs.size() * tabWidth() + plusWidth)) {
+            m_browser->requestTab();
+        }
+        return m_urlFocused;
+    }
+
+    if (x >= urlFieldLeft) {
+        setUrlFocused(true);
+        return true;
+    }
+
+    setUrlFocused(false);
+    switch ((x - 4) / (buttonSize + 4)) {
+    case 0:
+        goBack();
+        break;
+    case 1:
+        goForward();
+        break;
+    case 2:
+        reload();
+        break;
+    }
+    return false;
+}
+
+static void removeLastCharacter(std::string& text)
+{
+    // Continuation bytes of UTF-8 are 10xxxxxx.
+    while (!text.empty() && (text.back() & 0xC0) == 0x80)
+        text.pop_back();
+    if (!text.empty())
+        text.pop_back();
+}
+
+bool NativeChrome::keyPress(const NIXKeyEvent* event)
+{
+    bool down = event->type == kNIXInputEventTypeKeyDown;
+    if (event->modifiers & kNIXInputEventModifiersControlKey) {
+        if (event->key == 'T') {
+            if (down)
+                m_browser->requestTab();
+            return true;
+        }
+        if (event->key == 'W') {
+            if (down && m_currentTab != -1)
+                closeTab(m_currentTab);
+            return true;
+        }
+        if (event->key == 'L') {
+            if (down)
+                setUrlFocused(true);
+            return true;
+        }
+    }
+
+    if (!m_urlFocused)
+        return false;
+    if (!down)
+        return true;
+
+    switch (event->key) {
+    case kNIXKeyEventKey_Return:
+    case kNIXKeyEventKey_Enter:
+        loadUrl();
+        return true;
+    case kNIXKeyEventKey_Escape:
+        setUrlFocused(false);
+        return true;
+    case kNIXKeyEventKey_Backspace:
+        if (m_urlSelected)
+            m_urlText.clear();
+        else
+            removeLastCharacter(m_urlText);
+        break;
+    default:
+        // Control characters and shortcuts don't type anything.
+        if (!event->text || static_cast<unsigned char>(event->text[0]) < 0x20 || event->text[0] == 0x7F
+            || event->modifiers & (kNIXInputEventModifiersControlKey | kNIXInputEventModifiersAltKey))
+            return true;
+        if (m_urlSelected)
+            m_urlText.clear();
+        m_urlText += event->text;
+        break;
+    }
+    m_urlSelected = false;
+    update();
+    return true;
+}
+
+cairo_surface_t* NativeChrome::paint(int width)
+{
+    m_width = width;
+    cairo_surface_t* surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height());
+    cairo_t* cr = cairo_create(surface);
+    // GL textures start at the bottom row.
+    cairo_translate(cr, 0, height());
+    cairo_scale(cr, 1, -1);
+
+    cairo_select_font_face(cr, "sans-serif", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_size(cr, fontSize);
+    paintTabs(cr);
+    paintToolBar(cr);
+
+    cairo_destroy(cr);
+    cairo_surface_flush(surface);
+    return surface;
+}
+
+static void showClippedText(cairo_t* cr, const std::string& text, double x, double y, double width, double height)
+{
+    cairo_save(cr);
+    cairo_rectangle(cr, x, y, width, height);
+    cairo_clip(cr);
+    cairo_move_to(cr, x, y + (height + fontSize) / 2 - 2);
+    cairo_show_text(cr, text.c_str());
+    cairo_restore(cr);
+}
+
+void NativeChrome::paintTabs(cairo_t* cr)
+{
+    cairo_set_source_rgb(cr, 0.78, 0.80, 0.83);
+    cairo_rectangle(cr, 0, 0, m_width, tabBarHeight);
+    cairo_fill(cr);
+
+    int width = tabWidth();
+    for (size_t i = 0; i < m_tabs.size(); ++i) {
+        const TabItem& tab = m_tabs[i];
+        double x = i * width;
+        bool current = tab.id == m_currentTab;
+
+        if (current)
+            cairo_set_source_rgb(cr, 0.95, 0.95, 0.95);
+        else if (tab.busy)
+            cairo_set_source_rgb(cr, 0.90, 0.75, 0.72);
+        else
+            cairo_set_source_rgb(cr, 0.86, 0.87, 0.89);
+        cairo_rectangle(cr, x + 1, 4, width - 2, tabBarHeight - 4);
+        cairo_fill(cr);
+
+        std::string label = tab.crashed ? "Crashed" : !tab.title.empty() ? tab.title : !tab.url.empty() ? tab.url : "New Tab";
+        if (tab.discarded)
+            cairo_set_source_rgb(cr, 0.5, 0.5, 0.5);
+        else
+            cairo_set_source_rgb(cr, 0.1, 0.1, 0.1);
+        showClippedText(cr, label, x + 8, 4, width - closeSize - 20, tabBarHeight - 4);
+
+        // Close box.
+        double closeX = x + width - closeSize - 6 + 4;
+        double closeY = 4 + (tabBarHeight - 4 - closeSize) / 2 + 4;
+        double closeLength = closeSize - 8;
+        cairo_set_source_rgb(cr, 0.35, 0.35, 0.35);
+        cairo_set_line_width(cr, 1.5);
+        cairo_move_to(cr, closeX, closeY);
+        cairo_line_to(cr, closeX + closeLength, closeY + closeLength);
+        cairo_move_to(cr, closeX + closeLength, closeY);
+        cairo_line_to(cr, closeX, closeY + closeLength);
+        cairo_stroke(cr);
+    }
+
+    // New tab button.
+    double plusX = m_tabs.size() * width + plusWidth / 2;
+    double plusY = 4 + (tabBarHeight - 4) / 2;
+    cairo_set_source_rgb(cr, 0.25, 0.25, 0.25);
+    cairo_set_line_width(cr, 2);
+    cairo_move_to(cr, plusX - 6, plusY);
+    cairo_line_to(cr, plusX + 6, plusY);
+    cairo_move_to(cr, plusX, plusY - 6);
+    cairo_line_to(cr, plusX, plusY + 6);
+    cairo_stroke(cr);
+}
+
+void NativeChrome::paintToolBar(cairo_t* cr)
+{
+    cairo_set_source_rgb(cr, 0.95, 0.95, 0.95);
+    cairo_rectangle(cr, 0, tabBarHeight, m_width, toolBarHeight);
+    cairo_fill(cr);
+
+    // Back, forward and reload buttons.
+    double buttonY = tabBarHeight + (toolBarHeight - buttonSize) / 2;
+    double centerY = buttonY + buttonSize / 2;
+    cairo_set_source_rgb(cr, 0.3, 0.3, 0.3);
+    for (int i = 0; i < buttonCount; ++i) {
+        double centerX = 4 + i * (buttonSize + 4) + buttonSize / 2;
+        switch (i) {
+        case 0:
+        case 1: {
+            double direction = i ? 1 : -1;
+            cairo_move_to(cr, centerX + 6 * direction, centerY);
+            cairo_line_to(cr, centerX - 5 * direction, centerY - 7);
+            cairo_line_to(cr, centerX - 5 * direction, centerY + 7);
+            cairo_close_path(cr);
+            cairo_fill(cr);
+            break;
+        }
+        case 2:
+            cairo_set_line_width(cr, 2);
+            cairo_new_path(cr);
+            cairo_arc(cr, centerX, centerY, 7, 0, 1.5 * M_PI);
+            cairo_stroke(cr);
+            cairo_move_to(cr, centerX + 1, centerY - 11);
+            cairo_line_to(cr, centerX + 6, centerY - 7);
+            cairo_line_to(cr, centerX + 1, centerY - 3);
+            cairo_close_path(cr);
+            cairo_fill(cr);
+            break;
+        }
+    }
+
+    // URL field, with the progress of the current tab along its bottom.
+    double fieldY = tabBarHeight + (toolBarHeight - urlFieldHeight) / 2;
+    double fieldWidth = m_width - urlFieldLeft - 8;
+    cairo_set_source_rgb(cr, 1, 1, 1);
+    cairo_rectangle(cr, urlFieldLeft, fieldY, fieldWidth, urlFieldHeight);
+    cairo_fill(cr);
+    if (m_urlFocused)
+        cairo_set_source_rgb(cr, 0.3, 0.5, 0.9);
+    else
+        cairo_set_source_rgb(cr, 0.7, 0.7, 0.7);
+    cairo_set_line_width(cr, 1);
+    cairo_rectangle(cr, urlFieldLeft + 0.5, fieldY + 0.5, fieldWidth - 1, urlFieldHeight - 1);
+    cairo_stroke(cr);
+
+    const TabItem* tab = m_currentTab != -1 ? findTab(m_currentTab) : 0;
+    if (tab && tab->progress >= 0) {
+        cairo_set_source_rgb(cr, 0.3, 0.5, 0.9);
+        cairo_rectangle(cr, urlFieldLeft + 1, fieldY + urlFieldHeight - 1 - progressHeight, (fieldWidth - 2) * tab->progress, progressHeight);
+        cairo_fill(cr);
+    }
+
+    double textX = urlFieldLeft + 6;
+    double textWidth = fieldWidth - 12;
+    cairo_text_extents_t extents;
+    cairo_text_extents(cr, m_urlText.c_str(), &extents);
+    if (m_urlSelected && !m_urlText.empty()) {
+        cairo_set_source_rgb(cr, 0.7, 0.8, 1);
+        cairo_rectangle(cr, textX, fieldY + 4, std::min(extents.x_advance, textWidth), urlFieldHeight - 8);
+        cairo_fill(cr);
+    }
+    cairo_set_source_rgb(cr, 0.1, 0.1, 0.1);
+    showClippedText(cr, m_urlText, textX, fieldY, textWidth, urlFieldHeight);
+
+    // The text cursor is always at the end.
+    if (m_urlFocused && !m_urlSelected) {
+        double cursorX = std::floor(textX + std::min(extents.x_advance, textWidth)) + 0.5;
+        cairo_move_to(cr, cursorX, fieldY + 5);
+        cairo_line_to(cr, cursorX, fieldY + urlFieldHeight - 5);
+        cairo_stroke(cr);
+    }
+}
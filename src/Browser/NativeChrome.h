@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NativeChrome_h
+#define NativeChrome_h
+
+#include "Chrome.h"
+#include <NIXEvents.h>
+#include <vector>
+
+class Browser;
+typedef struct _cairo_surface cairo_surface_t;
+typedef struct _cairo cairo_t;
+
+// Tab strip and URL bar painted with cairo in the browser process, instead of ui.html in a web
+// process of its own. It has a fixed height, tabs get narrower instead of wrapping. Only used on
+// the main thread, the render thread gets the painted images.
+class NativeChrome : public Chrome
+{
+public:
+    NativeChrome(Browser*);
+
+    int height() const;
+
+    // Chrome
+    virtual void tabAdded(int tabId, bool background);
+    virtual void urlChanged(int tabId, const std::string& url);
+    virtual void titleChanged(int tabId, const std::string& title);
+    virtual void progressStarted(int tabId);
+    virtual void progressChanged(int tabId, double progress);
+    virtual void progressFinished(int tabId);
+    virtual void tabDiscarded(int tabId, bool discarded);
+    virtual void tabCrashed(int tabId);
+    virtual void tabResourceUsage(int tabId, double cpuPercent, double pssMegabytes);
+
+    // A click on the chrome, in window coordinates. Returns true if the URL field has the focus
+    // afterwards.
+    bool mousePress(const NIXMouseEvent*);
+    // Takes the shortcuts, and every key while the URL field has the focus. Returns false for keys
+    // that go to the current tab.
+    bool keyPress(const NIXKeyEvent*);
+    void setUrlFocused(bool);
+
+    // The chrome at the given window width, bottom row first like GL textures. Owned by the caller.
+    cairo_surface_t* paint(int width);
+
+private:
+    struct TabItem {
+        int id;
+        std::string url;
+        std::string title;
+        // Negative when not loading.
+        double progress;
+        bool discarded;
+        bool crashed;
+        bool busy;
+    };
+
+    Browser* m_browser;
+    std::vector<TabItem> m_tabs;
+    int m_currentTab;
+    std::string m_urlText;
+    bool m_urlFocused;
+    // Typing replaces the whole URL, like after a click on the field.
+    bool m_urlSelected;
+    // Of the last paint, input is hit tested against what is on screen.
+    int m_width;
+
+    TabItem* findTab(int tabId);
+    int tabWidth() const;
+    void selectTab(int tabId);
+    void closeTab(int tabId);
+    void loadUrl();
+    void goBack();
+    void goForward();
+    void reload();
+    // Repaints the chrome on the next frame.
+    void update();
+
+    void paintTabs(cairo_t*);
+    void paintToolBar(cairo_t*);
+};
+
+#endif
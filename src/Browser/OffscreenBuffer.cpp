@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define GL_GLEXT_PROTOTYPES 1
+#include "OffscreenBuffer.h"
+
+#include <GL/glext.h>
+#include <algorithm>
+#include <cairo.h>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+OffscreenBuffer::OffscreenBuffer(Attachments attachments)
+    : m_attachments(attachments)
+    , m_framebuffer(0)
+    , m_texture(0)
+    , m_depthStencil(0)
+    , m_previousFramebuffer(0)
+    , m_size(WKSizeMake(0, 0))
+{
+}
+
+OffscreenBuffer::~OffscreenBuffer()
+{
+    destroy();
+}
+
+bool OffscreenBuffer::isSupported()
+{
+    static int supported = -1;
+    if (supported != -1)
+        return supported;
+
+    int major = 0;
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    if (version)
+        sscanf(version, "%d", &major);
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    supported = major >= 3 || (extensions && strstr(extensions, "GL_ARB_framebuffer_object"));
+    return supported;
+}
+
+void OffscreenBuffer::destroy()
+{
+    if (m_framebuffer)
+        glDeleteFramebuffers(1, &m_framebuffer);
+    if (m_texture)
+        glDeleteTextures(1, &m_texture);
+    if (m_depthStencil)
+        glDeleteRenderbuffers(1, &m_depthStencil);
+    m_framebuffer = m_texture = m_depthStencil = 0;
+    m_size = WKSizeMake(0, 0);
+}
+
+bool OffscreenBuffer::resize(const WKSize& size)
+{
+    if (isValid() && size.width == m_size.width && size.height == m_size.height)
+        return true;
+
+    destroy();
+    if (!isSupported() || size.width <= 0 || size.height <= 0)
+        return false;
+
+    GLint previousFramebuffer;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.width, size.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // TextureMapperGL clips with the stencil buffer.
+    if (m_attachments == ColorDepthStencil) {
+        glGenRenderbuffers(1, &m_depthStencil);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_depthStencil);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, size.width, size.height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    }
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
+    if (m_depthStencil)
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthStencil);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Incomplete offscreen framebuffer: 0x" << std::hex << status << std::dec << std::endl;
+        destroy();
+        return false;
+    }
+
+    m_size = size;
+    return true;
+}
+
+void OffscreenBuffer::bind()
+{
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_previousFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+}
+
+void OffscreenBuffer::release()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_previousFramebuffer);
+}
+
+void OffscreenBuffer::blitToWindow(const WKRect& rect, const WKSize& windowSize)
+{
+    blitToWindow(rect, rect.origin, windowSize);
+}
+
+void OffscreenBuffer::blitToWindow(const WKRect& source, const WKPoint& destination, const WKSize& windowSize)
+{
+    // GL framebuffers have their origin on the lower left corner.
+    GLint srcX = source.origin.x;
+    GLint srcY = m_size.height - source.origin.y - source.size.height;
+    GLint dstX = destination.x;
+    GLint dstY = windowSize.height - destination.y - source.size.height;
+    GLint width = source.size.width;
+    GLint height = source.size.height;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glBlitFramebuffer(srcX, srcY, srcX + width, srcY + height, dstX, dstY, dstX + width, dstY + height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+void OffscreenBuffer::scaleToWindow(const WKRect& destination, const WKSize& windowSize)
+{
+    scaleToWindow(WKRectMake(0, 0, m_size.width, m_size.height), destination, windowSize);
+}
+
+void OffscreenBuffer::scaleToWindow(const WKRect& source, const WKRect& destination, const WKSize& windowSize)
+{
+    GLint srcX = source.origin.x;
+    GLint srcY = m_size.height - source.origin.y - source.size.height;
+    GLint dstX = destination.origin.x;
+    GLint dstY = windowSize.height - destination.origin.y - destination.size.height;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glBlitFramebuffer(srcX, srcY, srcX + source.size.width, srcY + source.size.height, dstX, dstY, dstX + destination.size.width, dstY + destination.size.height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+void OffscreenBuffer::copyFromWindow(const WKRect& rect, const WKSize& windowSize)
+{
+    GLint x = rect.origin.x;
+    GLint y = windowSize.height - rect.origin.y - rect.size.height;
+    GLint width = rect.size.width;
+    GLint height = rect.size.height;
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+    glBlitFramebuffer(x, y, x + width, y + height, x, y, x + width, y + height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+}
+
+void OffscreenBuffer::scaleFrom(const OffscreenBuffer& other, const WKRect& source)
+{
+    GLint srcX = source.origin.x;
+    GLint srcY = other.m_size.height - source.origin.y - source.size.height;
+
+    GLint previousFramebuffer;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, other.m_framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+    glBlitFramebuffer(srcX, srcY, srcX + source.size.width, srcY + source.size.height, 0, 0, m_size.width, m_size.height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+}
+
+cairo_surface_t* OffscreenBuffer::toImage(const WKRect& rect)
+{
+    int width = rect.size.width;
+    int height = rect.size.height;
+    cairo_surface_t* image = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
+    unsigned char* data = cairo_image_surface_get_data(image);
+    int stride = cairo_image_surface_get_stride(image);
+
+    // Cairo RGB24 is BGRX in memory on little endian machines.
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glPixelStorei(GL_PACK_ROW_LENGTH, stride / 4);
+    glReadPixels(rect.origin.x, m_size.height - rect.origin.y - height, width, height, GL_BGRA, GL_UNSIGNED_BYTE, data);
+    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    // GL rows go bottom to top.
+    for (int top = 0, bottom = height - 1; top < bottom; ++top, --bottom)
+        std::swap_ranges(data + top * stride, data + (top + 1) * stride, data + bottom * stride);
+
+    cairo_surface_mark_dirty(image);
+    return image;
+}
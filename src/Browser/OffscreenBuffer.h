@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OffscreenBuffer_h
+#define OffscreenBuffer_h
+
+#include <GL/gl.h>
+#include <WebKit2/WKGeometry.h>
+
+// A framebuffer object with a color texture, used to keep rendered views around between frames.
+// All methods must be called with the window GL context current.
+typedef struct _cairo_surface cairo_surface_t;
+
+class OffscreenBuffer
+{
+public:
+    enum Attachments {
+        ColorOnly,
+        // Needed to paint WebKit views into the buffer.
+        ColorDepthStencil
+    };
+
+    explicit OffscreenBuffer(Attachments = ColorDepthStencil);
+    ~OffscreenBuffer();
+
+    static bool isSupported();
+
+    // (Re)allocates the buffer storage, contents are undefined afterwards. Returns false on failure.
+    bool resize(const WKSize&);
+    WKSize size() const { return m_size; }
+    bool isValid() const { return m_framebuffer; }
+    GLuint texture() const { return m_texture; }
+
+    // Redirects drawing to the buffer, until release() is called.
+    void bind();
+    void release();
+
+    // Copies a rect, in top-left based window coordinates, to the same place in the window framebuffer.
+    void blitToWindow(const WKRect&, const WKSize& windowSize);
+    // Copies a rect of the buffer to the given position of the window framebuffer.
+    void blitToWindow(const WKRect& source, const WKPoint& destination, const WKSize& windowSize);
+    // Copies the whole buffer, or a rect of it, scaled to fill a rect of the window framebuffer.
+    void scaleToWindow(const WKRect& destination, const WKSize& windowSize);
+    void scaleToWindow(const WKRect& source, const WKRect& destination, const WKSize& windowSize);
+    // Copies a rect of the window framebuffer to the same place in the buffer.
+    void copyFromWindow(const WKRect&, const WKSize& windowSize);
+    // Fills the whole buffer with a rect of another buffer, scaled.
+    void scaleFrom(const OffscreenBuffer&, const WKRect& source);
+
+    // Reads back a rect, in top-left based coordinates, as a cairo RGB24 image owned by the caller.
+    cairo_surface_t* toImage(const WKRect&);
+
+private:
+    Attachments m_attachments;
+    GLuint m_framebuffer;
+    GLuint m_texture;
+    GLuint m_depthStencil;
+    GLint m_previousFramebuffer;
+    WKSize m_size;
+
+    void destroy();
+};
+
+#endif
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define GL_GLEXT_PROTOTYPES 1
+#include "PerformanceHud.h"
+
+#include "FrameTimings.h"
+#include <GL/glext.h>
+#include <algorithm>
+#include <cairo.h>
+#include <cstdio>
+#include <vector>
+
+static const int hudWidth = 360;
+static const int hudHeight = 120;
+static const int hudMargin = 8;
+static const int graphHeight = 40;
+// Number of frames used for the percentiles and the graph.
+static const size_t hudFrames = 240;
+static const double frameBudget = 1000.0 / 60;
+
+PerformanceHud::PerformanceHud()
+    : m_surface(cairo_image_surface_create(CAIRO_FORMAT_ARGB32, hudWidth, hudHeight))
+    , m_buffer(OffscreenBuffer::ColorOnly)
+{
+}
+
+PerformanceHud::~PerformanceHud()
+{
+    cairo_surface_destroy(m_surface);
+}
+
+WKRect PerformanceHud::rect(const WKRect& area) const
+{
+    return WKRectMake(area.origin.x + area.size.width - hudWidth - hudMargin, area.origin.y + hudMargin, hudWidth, hudHeight);
+}
+
+static void showPercentiles(cairo_t* cr, double y, const char* label, const std::vector<int64_t>& values)
+{
+    char text[128];
+    snprintf(text, sizeof(text), "%-9s p50 %6.2f  p95 %6.2f  p99 %6.2f ms", label,
+        FrameTimings::percentile(values, 50) / 1000.0,
+        FrameTimings::percentile(values, 95) / 1000.0,
+        FrameTimings::percentile(values, 99) / 1000.0);
+    cairo_move_to(cr, 6, y);
+    cairo_show_text(cr, text);
+}
+
+void PerformanceHud::draw(const FrameTimings& timings)
+{
+    std::vector<FrameTiming> frames = timings.last(hudFrames);
+    std::vector<int64_t> intervals, uiPaints, contentsPaints, swaps;
+    for (const FrameTiming& frame : frames) {
+        // The first frame after an idle period has a meaningless interval.
+        if (frame.interval)
+            intervals.push_back(frame.interval);
+        uiPaints.push_back(frame.uiPaint);
+        contentsPaints.push_back(frame.contentsPaint);
+        swaps.push_back(frame.swap);
+    }
+
+    cairo_t* cr = cairo_create(m_surface);
+    // GL textures start at the bottom row.
+    cairo_translate(cr, 0, hudHeight);
+    cairo_scale(cr, 1, -1);
+
+    // The HUD is blitted, so it's opaque.
+    cairo_set_source_rgb(cr, 0.1, 0.1, 0.1);
+    cairo_paint(cr);
+
+    cairo_select_font_face(cr, "monospace", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_size(cr, 11);
+    cairo_set_source_rgb(cr, 1, 1, 1);
+    showPercentiles(cr, 14, "interval", intervals);
+    showPercentiles(cr, 28, "ui", uiPaints);
+    showPercentiles(cr, 42, "contents", contentsPaints);
+    showPercentiles(cr, 56, "swap", swaps);
+
+    // Frame interval graph, scaled so two frame budgets fill it, with a line at one budget.
+    double barWidth = double(hudWidth - 12) / hudFrames;
+    double graphBottom = hudHeight - 6;
+    double x = 6 + (hudFrames - frames.size()) * barWidth;
+    for (const FrameTiming& frame : frames) {
+        double milliseconds = frame.interval / 1000.0;
+        double height = std::min(milliseconds / (2 * frameBudget), 1.0) * graphHeight;
+        if (milliseconds > frameBudget * 1.5)
+            cairo_set_source_rgb(cr, 0.9, 0.2, 0.2);
+        else
+            cairo_set_source_rgb(cr, 0.3, 0.8, 0.3);
+        cairo_rectangle(cr, x, graphBottom - height, std::max(barWidth - 0.5, 0.5), height);
+        cairo_fill(cr);
+        x += barWidth;
+    }
+    cairo_set_source_rgb(cr, 1, 1, 0);
+    cairo_set_line_width(cr, 1);
+    cairo_move_to(cr, 6, graphBottom - graphHeight / 2 + 0.5);
+    cairo_line_to(cr, hudWidth - 6, graphBottom - graphHeight / 2 + 0.5);
+    cairo_stroke(cr);
+
+    cairo_destroy(cr);
+    cairo_surface_flush(m_surface);
+}
+
+void PerformanceHud::paint(const FrameTimings& timings, const WKRect& area, const WKSize& windowSize)
+{
+    if (!m_buffer.resize(WKSizeMake(hudWidth, hudHeight)))
+        return;
+
+    draw(timings);
+
+    // Cairo ARGB32 is BGRA in memory on little endian machines.
+    glBindTexture(GL_TEXTURE_2D, m_buffer.texture());
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, cairo_image_surface_get_stride(m_surface) / 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, hudWidth, hudHeight, GL_BGRA, GL_UNSIGNED_BYTE, cairo_image_surface_get_data(m_surface));
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    WKRect hudRect = rect(area);
+    m_buffer.blitToWindow(WKRectMake(0, 0, hudWidth, hudHeight), hudRect.origin, windowSize);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PerformanceHud_h
+#define PerformanceHud_h
+
+#include "OffscreenBuffer.h"
+#include <WebKit2/WKGeometry.h>
+
+class FrameTimings;
+typedef struct _cairo_surface cairo_surface_t;
+
+// Overlay showing frame timing percentiles and a graph of the recent frame intervals.
+class PerformanceHud
+{
+public:
+    PerformanceHud();
+    ~PerformanceHud();
+
+    // Where the HUD is drawn, in window coordinates, given the area it must stay inside.
+    WKRect rect(const WKRect& area) const;
+
+    // Draws the HUD on the window framebuffer, must be called with the window GL context current.
+    void paint(const FrameTimings&, const WKRect& area, const WKSize& windowSize);
+
+private:
+    cairo_surface_t* m_surface;
+    OffscreenBuffer m_buffer;
+
+    void draw(const FrameTimings&);
+};
+
+#endif
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "PowerMonitor.h"
+
+#include <cassert>
+#include <fstream>
+#include <iostream>
+
+PowerMonitor::PowerMonitor(Client* client, int idleTimeoutSeconds)
+    : m_client(client)
+    , m_idleTimeout(int64_t(idleTimeoutSeconds) * G_USEC_PER_SEC)
+    , m_state(Active)
+    , m_stateStart(g_get_monotonic_time())
+    , m_lastActivity(m_stateStart)
+    , m_windowVisible(true)
+    , m_idleTimer(0)
+{
+    assert(client);
+    for (int64_t& time : m_timeInState)
+        time = 0;
+    scheduleIdleCheck();
+}
+
+PowerMonitor::~PowerMonitor()
+{
+    if (m_idleTimer)
+        g_source_remove(m_idleTimer);
+}
+
+const char* PowerMonitor::stateName(State state)
+{
+    switch (state) {
+    case Active:
+        return "active";
+    case Idle:
+        return "idle";
+    case Hidden:
+        return "hidden";
+    default:
+        return "unknown";
+    }
+}
+
+void PowerMonitor::userActivity()
+{
+    // Called for every input event, so only a timestamp is taken unless waking up.
+    m_lastActivity = g_get_monotonic_time();
+    if (m_state == Idle) {
+        setState(Active);
+        scheduleIdleCheck();
+    }
+}
+
+void PowerMonitor::setWindowVisible(bool visible)
+{
+    if (visible == m_windowVisible)
+        return;
+
+    m_windowVisible = visible;
+    if (!visible) {
+        setState(Hidden);
+        return;
+    }
+
+    // Showing the window again is something the user did.
+    m_lastActivity = g_get_monotonic_time();
+    setState(Active);
+    scheduleIdleCheck();
+}
+
+void PowerMonitor::setState(State state)
+{
+    if (state == m_state)
+        return;
+
+    int64_t now = g_get_monotonic_time();
+    m_timeInState[m_state] += now - m_stateStart;
+    m_stateStart = now;
+    m_state = state;
+    std::cout << "Power state: " << stateName(m_state) << std::endl;
+    m_client->onPowerStateChange(m_state);
+}
+
+void PowerMonitor::scheduleIdleCheck()
+{
+    if (!m_idleTimeout || m_idleTimer || m_state != Active)
+        return;
+
+    // A single timer for the whole timeout, activity meanwhile is checked when it fires.
+    int64_t remaining = m_lastActivity + m_idleTimeout - g_get_monotonic_time();
+    guint delay = remaining > 0 ? (remaining + 999) / 1000 : 0;
+    m_idleTimer = g_timeout_add(delay, idleCheckCallback, this);
+}
+
+gboolean PowerMonitor::idleCheckCallback(gpointer data)
+{
+    PowerMonitor* self = static_cast<PowerMonitor*>(data);
+    self->m_idleTimer = 0;
+    if (self->m_state != Active)
+        return false;
+
+    if (g_get_monotonic_time() - self->m_lastActivity >= self->m_idleTimeout)
+        self->setState(Idle);
+    else
+        self->scheduleIdleCheck();
+    return false;
+}
+
+int64_t PowerMonitor::timeInState(State state) const
+{
+    int64_t time = m_timeInState[state];
+    if (state == m_state)
+        time += g_get_monotonic_time() - m_stateStart;
+    return time;
+}
+
+bool PowerMonitor::writeToFile(const std::string& path) const
+{
+    std::ofstream out(path.c_str());
+    if (!out)
+        return false;
+
+    out << "state,seconds\n";
+    for (int state = 0; state < StateCount; ++state)
+        out << stateName(State(state)) << ',' << timeInState(State(state)) / double(G_USEC_PER_SEC) << '\n';
+    return out.good();
+}
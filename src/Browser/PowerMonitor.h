@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PowerMonitor_h
+#define PowerMonitor_h
+
+#include <glib.h>
+#include <stdint.h>
+#include <string>
+
+// Tracks user activity to move the browser between power states, and the time spent in each.
+// The browser is idle when neither window input nor gamepads were used for the idle timeout.
+class PowerMonitor
+{
+public:
+    enum State {
+        Active,
+        Idle,
+        // The window is minimized or covered, nothing is painted.
+        Hidden,
+        StateCount
+    };
+
+    class Client {
+    public:
+        virtual void onPowerStateChange(State) = 0;
+    };
+
+    // An idle timeout of 0 disables idle detection.
+    PowerMonitor(Client*, int idleTimeoutSeconds);
+    ~PowerMonitor();
+
+    State state() const { return m_state; }
+    static const char* stateName(State);
+
+    void userActivity();
+    void setWindowVisible(bool);
+
+    // In microseconds, including the time in the current state so far.
+    int64_t timeInState(State) const;
+    // Writes the time spent in each state as CSV, returns false on I/O errors.
+    bool writeToFile(const std::string& path) const;
+
+private:
+    Client* m_client;
+    int64_t m_idleTimeout;
+    State m_state;
+    int64_t m_stateStart;
+    int64_t m_timeInState[StateCount];
+    int64_t m_lastActivity;
+    bool m_windowVisible;
+    guint m_idleTimer;
+
+    void setState(State);
+    void scheduleIdleCheck();
+    static gboolean idleCheckCallback(gpointer);
+};
+
+#endif
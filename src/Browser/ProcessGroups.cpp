@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ProcessGroups.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <glib.h>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const int foregroundWeight = 1000;
+static const int backgroundWeight = 20;
+static const int cpuPeriodMicroseconds = 100000;
+static const int backgroundOomScoreAdjust = 500;
+// How long to wait for the web processes to exit before giving up on removing the cgroups.
+static const int removeTimeoutMilliseconds = 1000;
+
+static bool writeFile(const std::string& path, const std::string& value)
+{
+    std::ofstream out(path.c_str());
+    out << value;
+    out.close();
+    return !out.fail();
+}
+
+static bool makeCgroup(const std::string& path)
+{
+    return !mkdir(path.c_str(), 0755) || errno == EEXIST;
+}
+
+static bool removeCgroup(const std::string& path)
+{
+    return !rmdir(path.c_str()) || errno == ENOENT;
+}
+
+ProcessGroups::ProcessGroups(const std::string& root, int backgroundCpuPercent)
+    : m_root(root)
+    , m_hasCgroups(false)
+{
+    if (m_root.empty())
+        return;
+    m_hasCgroups = setUp(backgroundCpuPercent);
+    if (!m_hasCgroups)
+        std::cerr << "Can't set up the tab cgroups in " << m_root << ", background tabs won't be throttled" << std::endl;
+}
+
+ProcessGroups::~ProcessGroups()
+{
+    if (!m_hasCgroups)
+        return;
+
+    // The web processes are terminated along with their contexts, but exit asynchronously.
+    int64_t deadline = g_get_monotonic_time() + removeTimeoutMilliseconds * 1000;
+    for (;;) {
+        bool removed = removeCgroup(m_root + "/foreground");
+        removed = removeCgroup(m_root + "/background") && removed;
+        if (removed)
+            return;
+        if (g_get_monotonic_time() >= deadline) {
+            std::cerr << "Can't remove the tab cgroups in " << m_root << ", web processes are still running" << std::endl;
+            return;
+        }
+        g_usleep(50000);
+    }
+}
+
+bool ProcessGroups::setUp(int backgroundCpuPercent)
+{
+    // Cgroups with processes can't enable controllers for their children, and processes the
+    // browser didn't start aren't its to move.
+    std::ifstream procs((m_root + "/cgroup.procs").c_str());
+    std::string pid;
+    if (!procs || procs >> pid)
+        return false;
+
+    // I/O may not be delegated, CPU is enough to be useful.
+    if (!writeFile(m_root + "/cgroup.subtree_control", "+cpu"))
+        return false;
+    writeFile(m_root + "/cgroup.subtree_control", "+io");
+
+    if (!makeCgroup(m_root + "/foreground") || !makeCgroup(m_root + "/background"))
+        return false;
+
+    std::ostringstream weight;
+    weight << foregroundWeight;
+    writeFile(m_root + "/foreground/cpu.weight", weight.str());
+    writeFile(m_root + "/foreground/io.weight", weight.str());
+    weight.str(std::string());
+    weight << backgroundWeight;
+    writeFile(m_root + "/background/cpu.weight", weight.str());
+    writeFile(m_root + "/background/io.weight", weight.str());
+    std::ostringstream quota;
+    quota << cpuPeriodMicroseconds * backgroundCpuPercent / 100 << ' ' << cpuPeriodMicroseconds;
+    return writeFile(m_root + "/background/cpu.max", quota.str());
+}
+
+void ProcessGroups::place(const std::map<pid_t, bool>& foreground)
+{
+    for (const std::pair<const pid_t, bool>& process : foreground) {
+        std::map<pid_t, bool>::const_iterator current = m_foreground.find(process.first);
+        if (process.first > 0 && (current == m_foreground.end() || current->second != process.second))
+            setForeground(process.first, process.second);
+    }
+    m_foreground = foreground;
+}
+
+void ProcessGroups::setForeground(pid_t pid, bool foreground)
+{
+    std::ostringstream pidString;
+    pidString << pid;
+    if (m_hasCgroups && !writeFile(m_root + (foreground ? "/foreground" : "/background") + "/cgroup.procs", pidString.str()))
+        std::cerr << "Can't move process " << pid << " to the " << (foreground ? "foreground" : "background") << " cgroup: " << strerror(errno) << std::endl;
+
+    // Going back to 0 is allowed without privileges, as 0 is the lowest value we ever set.
+    std::ostringstream oomScore;
+    oomScore << (foreground ? 0 : backgroundOomScoreAdjust);
+    writeFile("/proc/" + pidString.str() + "/oom_score_adj", oomScore.str());
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ProcessGroups_h
+#define ProcessGroups_h
+
+#include <map>
+#include <string>
+#include <sys/types.h>
+
+// Moves web processes between a foreground and a background cgroup v2 child. Background
+// processes get a CPU quota and low CPU and I/O weights, and are the first ones the OOM killer
+// picks. The cgroups need a delegated cgroup without processes of its own, since those can't
+// enable controllers for their children, so they're only set up in the one given.
+class ProcessGroups
+{
+public:
+    // Without root, processes are only given OOM scores.
+    ProcessGroups(const std::string& root, int backgroundCpuPercent);
+    // Removes the cgroups, once the web processes in them exited.
+    ~ProcessGroups();
+
+    // False if the cgroups couldn't be set up, processes are then only given OOM scores.
+    bool hasCgroups() const { return m_hasCgroups; }
+
+    // Takes all web processes, true for the foreground ones. Only moves the processes that
+    // changed since the last call, processes left out are forgotten.
+    void place(const std::map<pid_t, bool>& foreground);
+
+private:
+    std::string m_root;
+    bool m_hasCgroups;
+    std::map<pid_t, bool> m_foreground;
+
+    bool setUp(int backgroundCpuPercent);
+    void setForeground(pid_t, bool foreground);
+};
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "RenderThread.h"
+
+#include "DesktopWindow.h"
+
+RenderThread::RenderThread(DesktopWindow* window)
+    : m_window(window)
+    , m_quit(false)
+{
+    g_mutex_init(&m_mutex);
+    g_cond_init(&m_tasksCond);
+    g_cond_init(&m_doneCond);
+
+    // A context can only be current on one thread at a time.
+    m_window->doneCurrent();
+    m_thread = g_thread_new("Render", threadMain, this);
+}
+
+RenderThread::~RenderThread()
+{
+    g_mutex_lock(&m_mutex);
+    m_quit = true;
+    g_cond_signal(&m_tasksCond);
+    g_mutex_unlock(&m_mutex);
+    g_thread_join(m_thread);
+
+    m_window->makeCurrent();
+    g_cond_clear(&m_doneCond);
+    g_cond_clear(&m_tasksCond);
+    g_mutex_clear(&m_mutex);
+}
+
+void RenderThread::post(const std::function<void()>& task)
+{
+    g_mutex_lock(&m_mutex);
+    m_tasks.push_back(task);
+    g_cond_signal(&m_tasksCond);
+    g_mutex_unlock(&m_mutex);
+}
+
+void RenderThread::sync(const std::function<void()>& task)
+{
+    bool done = false;
+    post([this, &task, &done] {
+        task();
+        g_mutex_lock(&m_mutex);
+        done = true;
+        g_cond_signal(&m_doneCond);
+        g_mutex_unlock(&m_mutex);
+    });
+
+    g_mutex_lock(&m_mutex);
+    while (!done)
+        g_cond_wait(&m_doneCond, &m_mutex);
+    g_mutex_unlock(&m_mutex);
+}
+
+gpointer RenderThread::threadMain(gpointer data)
+{
+    RenderThread* self = static_cast<RenderThread*>(data);
+
+    g_mutex_lock(&self->m_mutex);
+    while (true) {
+        while (self->m_tasks.empty() && !self->m_quit)
+            g_cond_wait(&self->m_tasksCond, &self->m_mutex);
+        if (self->m_tasks.empty())
+            break;
+
+        std::function<void()> task = self->m_tasks.front();
+        self->m_tasks.pop_front();
+        g_mutex_unlock(&self->m_mutex);
+
+        // Made current every time since the headless window recreates its surface on resize.
+        self->m_window->makeCurrent();
+        task();
+
+        g_mutex_lock(&self->m_mutex);
+    }
+    g_mutex_unlock(&self->m_mutex);
+
+    self->m_window->doneCurrent();
+    return 0;
+}
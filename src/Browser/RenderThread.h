@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RenderThread_h
+#define RenderThread_h
+
+#include <deque>
+#include <functional>
+#include <glib.h>
+
+class DesktopWindow;
+
+// Owns the window GL context and runs all GL work, so a slow paint or a swap blocked on vsync
+// doesn't delay input handling on the main loop. Tasks run in the order they are posted.
+// While the thread exists the context isn't current on the main thread.
+class RenderThread
+{
+public:
+    explicit RenderThread(DesktopWindow*);
+    // Runs the pending tasks, then gives the context back to the calling thread.
+    ~RenderThread();
+
+    // Queues a task to run with the window GL context current, without waiting for it.
+    void post(const std::function<void()>&);
+    // Runs a task with the window GL context current and waits until it's done, along with
+    // everything posted before it.
+    void sync(const std::function<void()>&);
+
+private:
+    DesktopWindow* m_window;
+    GThread* m_thread;
+    GMutex m_mutex;
+    GCond m_tasksCond;
+    GCond m_doneCond;
+    std::deque<std::function<void()> > m_tasks;
+    bool m_quit;
+
+    static gpointer threadMain(gpointer);
+};
+
+#endif
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ResourceMonitor.h"
+
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+static const guint sampleIntervalMilliseconds = 2000;
+
+// utime plus stime in clock ticks, from the fields after the parenthesized command name, which
+// may contain spaces.
+static bool readCpuTicks(pid_t pid, uint64_t* ticks)
+{
+    std::ostringstream path;
+    path << "/proc/" << pid << "/stat";
+    std::ifstream in(path.str().c_str());
+    std::string stat;
+    if (!std::getline(in, stat))
+        return false;
+
+    size_t commandEnd = stat.rfind(')');
+    if (commandEnd == std::string::npos)
+        return false;
+    std::istringstream fields(stat.substr(commandEnd + 2));
+    std::string field;
+    // State is field 3 and utime field 14 of the whole line.
+    for (int i = 3; i < 14; ++i)
+        fields >> field;
+    uint64_t utime, stime;
+    if (!(fields >> utime >> stime))
+        return false;
+    *ticks = utime + stime;
+    return true;
+}
+
+static long readPss(pid_t pid)
+{
+    std::ostringstream path;
+    path << "/proc/" << pid << "/smaps_rollup";
+    std::ifstream in(path.str().c_str());
+    std::string line;
+    while (std::getline(in, line)) {
+        long value;
+        if (sscanf(line.c_str(), "Pss: %ld kB", &value) == 1)
+            return value;
+    }
+    return -1;
+}
+
+ResourceMonitor::ResourceMonitor(Client* client, const std::string& logFile)
+    : m_client(client)
+    , m_timer(g_timeout_add(sampleIntervalMilliseconds, sampleCallback, this))
+{
+    assert(client);
+    if (logFile.empty())
+        return;
+    m_log.open(logFile.c_str());
+    if (m_log.is_open())
+        m_log << "seconds,tab,pid,cpu_percent,pss_kb,hidden_repaints,hang_ms,hang_outcome\n";
+    else
+        std::cerr << "Can't write resource usage to " << logFile << std::endl;
+}
+
+ResourceMonitor::~ResourceMonitor()
+{
+    g_source_remove(m_timer);
+}
+
+gboolean ResourceMonitor::sampleCallback(gpointer data)
+{
+    static_cast<ResourceMonitor*>(data)->sample();
+    return true;
+}
+
+void ResourceMonitor::sample()
+{
+    std::vector<TabProcess> tabs = m_client->tabProcesses();
+    std::map<pid_t, int> tabsPerProcess;
+    for (const TabProcess& tab : tabs) {
+        if (tab.pid > 0)
+            ++tabsPerProcess[tab.pid];
+    }
+
+    // Usage of each process, split between its tabs.
+    struct ProcessUsage {
+        double cpuPercent;
+        long pssKilobytes;
+    };
+    std::map<pid_t, ProcessUsage> processUsage;
+    std::map<pid_t, ProcessSample> samples;
+    static const double ticksPerSecond = sysconf(_SC_CLK_TCK);
+    int64_t now = g_get_monotonic_time();
+    for (const std::pair<const pid_t, int>& process : tabsPerProcess) {
+        ProcessSample sample = { 0, now };
+        if (!readCpuTicks(process.first, &sample.cpuTicks))
+            continue;
+        samples[process.first] = sample;
+
+        // The first sample of a process only gives a starting point.
+        double cpuPercent = 0;
+        std::map<pid_t, ProcessSample>::const_iterator last = m_lastSamples.find(process.first);
+        if (last != m_lastSamples.end() && now > last->second.time) {
+            double cpuSeconds = (sample.cpuTicks - last->second.cpuTicks) / ticksPerSecond;
+            cpuPercent = cpuSeconds * G_USEC_PER_SEC / (now - last->second.time) * 100;
+        }
+        long pss = readPss(process.first);
+        ProcessUsage usage = { cpuPercent / process.second, pss < 0 ? 0 : pss / process.second };
+        processUsage[process.first] = usage;
+    }
+    // Exited processes are dropped here too.
+    m_lastSamples.swap(samples);
+
+    std::vector<Usage> result;
+    for (const TabProcess& tab : tabs) {
+        std::map<pid_t, ProcessUsage>::const_iterator usage = processUsage.find(tab.pid);
+        if (usage == processUsage.end())
+            continue;
+        Usage tabUsage = { tab.tabId, tab.pid, usage->second.cpuPercent, usage->second.pssKilobytes };
+        result.push_back(tabUsage);
+        if (m_log.is_open())
+            m_log << now / double(G_USEC_PER_SEC) << ',' << tab.tabId << ',' << tab.pid << ',' << tabUsage.cpuPercent << ',' << tabUsage.pssKilobytes << ',' << tab.suppressedDisplayRequests << ",,\n";
+    }
+    if (m_log.is_open())
+        m_log.flush();
+    m_client->onResourceUsage(result);
+}
+
+void ResourceMonitor::logHang(int tabId, pid_t pid, int64_t durationMilliseconds, const char* outcome)
+{
+    if (!m_log.is_open())
+        return;
+    m_log << g_get_monotonic_time() / double(G_USEC_PER_SEC) << ',' << tabId << ',' << pid << ",,,," << durationMilliseconds << ',' << outcome << '\n';
+    m_log.flush();
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ResourceMonitor_h
+#define ResourceMonitor_h
+
+#include <fstream>
+#include <glib.h>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+// Samples the CPU time and proportional set size of the web processes from /proc. Tabs sharing
+// a process get an even share of its usage, there's no way to tell which page used what.
+class ResourceMonitor
+{
+public:
+    struct TabProcess {
+        int tabId;
+        pid_t pid;
+        // See Tab::suppressedDisplayRequests().
+        unsigned suppressedDisplayRequests;
+    };
+
+    struct Usage {
+        int tabId;
+        pid_t pid;
+        // Of one core, can go over 100 for multithreaded processes.
+        double cpuPercent;
+        long pssKilobytes;
+    };
+
+    class Client {
+    public:
+        virtual std::vector<TabProcess> tabProcesses() = 0;
+        virtual void onResourceUsage(const std::vector<Usage>&) = 0;
+    };
+
+    // Also writes every sample as CSV to logFile, if not empty.
+    ResourceMonitor(Client*, const std::string& logFile);
+    ~ResourceMonitor();
+
+    // Adds a row for a hang that ended to the log, with the usage columns left empty. See
+    // HangMonitor.
+    void logHang(int tabId, pid_t, int64_t durationMilliseconds, const char* outcome);
+
+private:
+    struct ProcessSample {
+        uint64_t cpuTicks;
+        int64_t time;
+    };
+
+    Client* m_client;
+    std::ofstream m_log;
+    std::map<pid_t, ProcessSample> m_lastSamples;
+    guint m_timer;
+
+    void sample();
+    static gboolean sampleCallback(gpointer);
+};
+
+#endif
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RingBuffer_h
+#define RingBuffer_h
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Fixed size buffer keeping the last Capacity items pushed. Lock-free for a single writer, readers
+// may run on other threads but can see a torn item if the writer laps them while copying.
+template<typename T, size_t Capacity>
+class RingBuffer
+{
+public:
+    RingBuffer() : m_written(0) {}
+
+    void push(const T& item)
+    {
+        size_t written = m_written.load(std::memory_order_relaxed);
+        m_items[written % Capacity] = item;
+        m_written.store(written + 1, std::memory_order_release);
+    }
+
+    // Number of items pushed since creation, including the ones already overwritten.
+    size_t totalPushed() const { return m_written.load(std::memory_order_acquire); }
+
+    // Copies the last count items, oldest first.
+    std::vector<T> last(size_t count = Capacity) const
+    {
+        size_t written = m_written.load(std::memory_order_acquire);
+        count = std::min(count, std::min(written, Capacity));
+
+        std::vector<T> result;
+        result.reserve(count);
+        for (size_t i = written - count; i < written; ++i)
+            result.push_back(m_items[i % Capacity]);
+        return result;
+    }
+
+private:
+    T m_items[Capacity];
+    std::atomic<size_t> m_written;
+};
+
+#endif
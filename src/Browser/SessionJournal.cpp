@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "SessionJournal.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+// The journal is rewritten when it has this many more records than needed to describe the tabs.
+static const unsigned maxRedundantRecords = 256;
+
+static std::vector<SessionJournal::Tab>::iterator findTab(std::vector<SessionJournal::Tab>& tabs, int id)
+{
+    return std::find_if(tabs.begin(), tabs.end(), [id](const SessionJournal::Tab& tab) { return tab.id == id; });
+}
+
+static bool writeAll(int fd, const std::string& data)
+{
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t result = write(fd, data.data() + written, data.size() - written);
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            return false;
+        written += result;
+    }
+    return true;
+}
+
+SessionJournal::SessionJournal(const std::string& path)
+    : m_path(path)
+    , m_fd(-1)
+    , m_currentTab(-1)
+    , m_records(0)
+    , m_savedCurrentTab(-1)
+{
+    std::ifstream in(path.c_str());
+    std::string line;
+    int currentId = -1;
+    // Lines without a newline at the end were cut short by a crash.
+    while (std::getline(in, line) && !in.eof())
+        apply(line, m_savedTabs, currentId);
+
+    std::vector<Tab>::iterator current = findTab(m_savedTabs, currentId);
+    if (current != m_savedTabs.end())
+        m_savedCurrentTab = current - m_savedTabs.begin();
+}
+
+SessionJournal::~SessionJournal()
+{
+    if (m_fd != -1)
+        close(m_fd);
+}
+
+bool SessionJournal::apply(const std::string& line, std::vector<Tab>& tabs, int& currentTab)
+{
+    std::istringstream in(line);
+    std::string type;
+    int id;
+    if (!(in >> type >> id))
+        return false;
+    std::string value;
+    if (in.get() == ' ')
+        std::getline(in, value);
+
+    std::vector<Tab>::iterator tab = findTab(tabs, id);
+    if (type == "tab" && tab == tabs.end()) {
+        Tab newTab = { id, std::string(), std::string() };
+        tabs.push_back(newTab);
+    } else if (type == "close" && tab != tabs.end()) {
+        tabs.erase(tab);
+    } else if (type == "url" && tab != tabs.end()) {
+        tab->url = value;
+    } else if (type == "title" && tab != tabs.end()) {
+        tab->title = value;
+    } else if (type == "current") {
+        currentTab = id;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void SessionJournal::start()
+{
+    if (m_fd == -1)
+        compact();
+}
+
+void SessionJournal::tabAdded(int id)
+{
+    record("tab", id);
+}
+
+void SessionJournal::tabClosed(int id)
+{
+    record("close", id);
+}
+
+void SessionJournal::urlChanged(int id, const std::string& url)
+{
+    record("url", id, url);
+}
+
+void SessionJournal::titleChanged(int id, const std::string& title)
+{
+    record("title", id, title);
+}
+
+void SessionJournal::currentTabChanged(int id)
+{
+    record("current", id);
+}
+
+void SessionJournal::record(const std::string& type, int id, const std::string& value)
+{
+    std::ostringstream line;
+    line << type << ' ' << id;
+    if (!value.empty()) {
+        std::string singleLine(value);
+        std::replace(singleLine.begin(), singleLine.end(), '\n', ' ');
+        line << ' ' << singleLine;
+    }
+    line << '\n';
+
+    if (!apply(line.str(), m_tabs, m_currentTab) || m_fd == -1)
+        return;
+
+    ++m_records;
+    if (m_records > m_tabs.size() * 3 + 1 + maxRedundantRecords)
+        compact();
+    else if (!writeAll(m_fd, line.str()))
+        std::cerr << "Can't write to the session journal " << m_path << ": " << strerror(errno) << std::endl;
+}
+
+void SessionJournal::compact()
+{
+    std::ostringstream snapshot;
+    m_records = 0;
+    for (const Tab& tab : m_tabs) {
+        snapshot << "tab " << tab.id << '\n';
+        ++m_records;
+        if (!tab.url.empty()) {
+            snapshot << "url " << tab.id << ' ' << tab.url << '\n';
+            ++m_records;
+        }
+        if (!tab.title.empty()) {
+            snapshot << "title " << tab.id << ' ' << tab.title << '\n';
+            ++m_records;
+        }
+    }
+    if (m_currentTab != -1) {
+        snapshot << "current " << m_currentTab << '\n';
+        ++m_records;
+    }
+
+    if (m_fd != -1)
+        close(m_fd);
+    m_fd = -1;
+
+    // Either the old or the new journal is on disk whenever the browser dies.
+    std::string temporaryPath = m_path + ".tmp";
+    int fd = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd == -1 || !writeAll(fd, snapshot.str()) || fsync(fd) || rename(temporaryPath.c_str(), m_path.c_str())) {
+        std::cerr << "Can't write the session journal " << m_path << ": " << strerror(errno) << std::endl;
+        if (fd != -1)
+            close(fd);
+        return;
+    }
+    close(fd);
+    m_fd = open(m_path.c_str(), O_WRONLY | O_APPEND);
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SessionJournal_h
+#define SessionJournal_h
+
+#include <string>
+#include <vector>
+
+// Keeps the open tabs on disk so the next run can restore them. Each change is appended to the
+// journal as one line as it happens, and the journal is rewritten from scratch once it has grown
+// too much. Rewrites go through a temporary file renamed over the journal, and a partially
+// written last line is ignored on load, so a crash loses at most the last change.
+class SessionJournal
+{
+public:
+    struct Tab {
+        int id;
+        std::string url;
+        std::string title;
+    };
+
+    explicit SessionJournal(const std::string& path);
+    ~SessionJournal();
+
+    // The tabs of the last run in order, and the index of the current one or -1.
+    const std::vector<Tab>& savedTabs() const { return m_savedTabs; }
+    int savedCurrentTab() const { return m_savedCurrentTab; }
+
+    // Writes all changes recorded so far and appends the next ones as they come. Nothing is
+    // written before, so the saved session survives until the restored one replaces it.
+    void start();
+
+    void tabAdded(int id);
+    void tabClosed(int id);
+    void urlChanged(int id, const std::string& url);
+    void titleChanged(int id, const std::string& title);
+    void currentTabChanged(int id);
+
+private:
+    std::string m_path;
+    int m_fd;
+    std::vector<Tab> m_tabs;
+    int m_currentTab;
+    unsigned m_records;
+
+    std::vector<Tab> m_savedTabs;
+    int m_savedCurrentTab;
+
+    void record(const std::string& type, int id, const std::string& value = std::string());
+    void compact();
+    static bool apply(const std::string& line, std::vector<Tab>&, int& currentTab);
+};
+
+#endif
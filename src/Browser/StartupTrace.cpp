@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "StartupTrace.h"
+
+#include <algorithm>
+#include <fstream>
+#include <glib.h>
+#include <sstream>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+static GMutex mutex;
+static int64_t milestones[StartupTrace::MilestoneCount];
+
+void StartupTrace::mark(Milestone milestone)
+{
+    g_mutex_lock(&mutex);
+    if (!milestones[milestone])
+        milestones[milestone] = g_get_monotonic_time();
+    g_mutex_unlock(&mutex);
+}
+
+int64_t StartupTrace::time(Milestone milestone)
+{
+    g_mutex_lock(&mutex);
+    int64_t result = milestones[milestone];
+    g_mutex_unlock(&mutex);
+    return result;
+}
+
+bool StartupTrace::isComplete()
+{
+    for (int milestone = 0; milestone < MilestoneCount; ++milestone) {
+        if (!time(Milestone(milestone)))
+            return false;
+    }
+    return true;
+}
+
+const char* StartupTrace::milestoneName(Milestone milestone)
+{
+    switch (milestone) {
+    case MainEntered:
+        return "main";
+    case GLContextCreated:
+        return "gl_context_created";
+    case WindowSetUp:
+        return "window_set_up";
+    case UiLoadStarted:
+        return "ui_load_started";
+    case UiReady:
+        return "ui_ready";
+    case FirstTabCreated:
+        return "first_tab_created";
+    case FirstContentCommitted:
+        return "first_content_committed";
+    case FirstContentFrameSwapped:
+        return "first_content_frame_swapped";
+    default:
+        return "unknown";
+    }
+}
+
+std::string StartupTrace::summary()
+{
+    int64_t start = time(MainEntered);
+    std::ostringstream out;
+    out << "Startup:";
+    for (int milestone = MainEntered + 1; milestone < MilestoneCount; ++milestone) {
+        int64_t milestoneTime = time(Milestone(milestone));
+        out << ' ' << milestoneName(Milestone(milestone)) << '=';
+        if (milestoneTime)
+            out << (milestoneTime - start) / 1000.0 << "ms";
+        else
+            out << '-';
+    }
+    return out.str();
+}
+
+bool StartupTrace::writeToFile(const std::string& path)
+{
+    std::vector<std::pair<int64_t, Milestone> > reached;
+    for (int milestone = 0; milestone < MilestoneCount; ++milestone) {
+        if (int64_t milestoneTime = time(Milestone(milestone)))
+            reached.push_back(std::make_pair(milestoneTime, Milestone(milestone)));
+    }
+    std::sort(reached.begin(), reached.end());
+
+    std::ofstream out(path.c_str());
+    if (!out)
+        return false;
+
+    // An instant event per milestone, and a span from each milestone to the next one named
+    // after where it ends, so the trace viewer shows what each step took.
+    pid_t pid = getpid();
+    out << "{\"traceEvents\":[\n";
+    for (size_t i = 0; i < reached.size(); ++i) {
+        const char* name = milestoneName(reached[i].second);
+        out << "{\"name\":\"" << name << "\",\"cat\":\"startup\",\"ph\":\"i\",\"s\":\"p\",\"ts\":" << reached[i].first
+            << ",\"pid\":" << pid << ",\"tid\":" << pid << "}";
+        if (i) {
+            out << ",\n{\"name\":\"" << name << "\",\"cat\":\"startup\",\"ph\":\"X\",\"ts\":" << reached[i - 1].first
+                << ",\"dur\":" << reached[i].first - reached[i - 1].first << ",\"pid\":" << pid << ",\"tid\":" << pid << "}";
+        }
+        out << (i + 1 < reached.size() ? ",\n" : "\n");
+    }
+    out << "],\"displayTimeUnit\":\"ms\"}\n";
+    return out.good();
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef StartupTrace_h
+#define StartupTrace_h
+
+#include <stdint.h>
+#include <string>
+
+// Times the way from main() to the first page on screen. Each milestone keeps the monotonic
+// time it was first reached, from any thread.
+class StartupTrace
+{
+public:
+    enum Milestone {
+        MainEntered,
+        GLContextCreated,
+        WindowSetUp,
+        UiLoadStarted,
+        UiReady,
+        FirstTabCreated,
+        FirstContentCommitted,
+        FirstContentFrameSwapped,
+        MilestoneCount
+    };
+
+    static void mark(Milestone);
+    static bool isComplete();
+    static const char* milestoneName(Milestone);
+
+    // One line with the milestones in milliseconds since main().
+    static std::string summary();
+    // In the Chrome trace event format, returns false on I/O errors.
+    static bool writeToFile(const std::string& path);
+
+private:
+    static int64_t time(Milestone);
+};
+
+#endif
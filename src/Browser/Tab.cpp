@@ -32,6 +32,7 @@
 #include <WebKit2/WKError.h>
 #include <WebKit2/WKNumber.h>
 #include <WebKit2/WKPage.h>
+#include <WebKit2/WKPagePrivate.h>
 #include <WebKit2/WKFrame.h>
 #include <WebKit2/WKString.h>
 #include <WebKit2/WKURL.h>
@@ -39,18 +40,27 @@
 #include <WebKit2/WKType.h>
 #include <WebKit2/WKHitTestResult.h>
 #include "Browser.h"
+#include "Chrome.h"
+#include "ContextPool.h"
 #include "InjectedBundleGlue.h"
+#include "StartupTrace.h"
 
 static int nextTabId = 0;
 
-Tab::Tab(Browser* browser)
+Tab::Tab(Browser* browser, WKContextRef context)
     : m_id(nextTabId++)
     , m_browser(browser)
+    , m_context(context)
+    , m_visibility(kWKPageVisibilityStateHidden)
+    , m_needsDisplay(false)
+    , m_suppressedDisplayRequests(0)
+    , m_lastVisibleTime(g_get_monotonic_time())
+    , m_sessionState(0)
+    , m_crashBackoff(m_browser->options().crashRetries)
+    , m_crashReloadTimer(0)
+    , m_terminated(false)
 {
-    // FIXME Find a good way to find where the injected bundle is
-    WKStringRef wkStr = WKStringCreateWithUTF8CString((getApplicationPath() + "/../ContentsInjectedBundle/libPageBundle.so").c_str());
-    m_context = WKContextCreateWithInjectedBundlePath(wkStr);
-    WKRelease(wkStr);
+    WKRetain(m_context);
     init();
 }
 
@@ -58,19 +68,48 @@ Tab::Tab(Tab* parent)
     : m_id(nextTabId++)
     , m_browser(parent->m_browser)
     , m_context(parent->m_context)
+    , m_visibility(kWKPageVisibilityStateHidden)
+    , m_needsDisplay(false)
+    , m_suppressedDisplayRequests(0)
+    , m_lastVisibleTime(g_get_monotonic_time())
+    , m_sessionState(0)
+    , m_crashBackoff(m_browser->options().crashRetries)
+    , m_crashReloadTimer(0)
+    , m_terminated(false)
 {
     WKRetain(m_context);
+    m_browser->contextPool()->addTab(m_context);
     init();
-    WKPageSetVisibilityState(m_page, kWKPageVisibilityStateHidden, true);
+}
+
+Tab::Tab(Browser* browser, const std::string& url, const std::string& title)
+    : m_id(nextTabId++)
+    , m_browser(browser)
+    , m_view(0)
+    , m_page(0)
+    , m_context(0)
+    , m_visibility(kWKPageVisibilityStateHidden)
+    , m_needsDisplay(true)
+    , m_suppressedDisplayRequests(0)
+    , m_lastVisibleTime(g_get_monotonic_time())
+    , m_sessionState(0)
+    , m_url(url)
+    , m_title(title)
+    , m_crashBackoff(m_browser->options().crashRetries)
+    , m_crashReloadTimer(0)
+    , m_terminated(false)
+{
 }
 
 void Tab::init()
 {
+    // Tabs start hidden, Browser::setCurrentTab shows them.
     m_view = WKViewCreate(m_context, m_browser->contentPageGroup());
     WKViewInitialize(m_view);
     WKViewSetIsFocused(m_view, true);
-    WKViewSetIsVisible(m_view, true);
+    WKViewSetIsVisible(m_view, false);
     m_page = WKViewGetPage(m_view);
+    WKPageSetVisibilityState(m_page, m_visibility, true);
     WKStringRef appName = WKStringCreateWithUTF8CString("Drowser");
     WKPageSetApplicationNameForUserAgent(m_page, appName);
     WKRelease(appName);
@@ -93,6 +132,8 @@ void Tab::init()
     loaderClient.didCommitLoadForFrame = &Tab::onCommitLoadForFrame;
     loaderClient.didReceiveTitleForFrame = &Tab::onReceiveTitleForFrame;
     loaderClient.didFailProvisionalLoadWithErrorForFrame = &Tab::onFailProvisionalLoadWithErrorForFrameCallback;
+    loaderClient.processDidBecomeUnresponsive = &Tab::onProcessDidBecomeUnresponsiveCallback;
+    loaderClient.processDidBecomeResponsive = &Tab::onProcessDidBecomeResponsiveCallback;
 
     WKPageSetPageLoaderClient(m_page, &loaderClient);
 
@@ -108,28 +149,84 @@ void Tab::init()
 
 Tab::~Tab()
 {
+    if (m_crashReloadTimer)
+        g_source_remove(m_crashReloadTimer);
+
+    if (isDiscarded()) {
+        if (m_sessionState)
+            WKRelease(m_sessionState);
+        return;
+    }
+
     WKPageClose(m_page);
+    m_browser->contextPool()->removeTab(m_context);
     WKRelease(m_context);
 
     WKRelease(m_view);
 }
 
+pid_t Tab::processId() const
+{
+    return isDiscarded() ? 0 : WKPageGetProcessIdentifier(m_page);
+}
+
+void Tab::discard()
+{
+    assert(!isDiscarded() && !isVisible());
+
+    if (m_crashReloadTimer) {
+        g_source_remove(m_crashReloadTimer);
+        m_crashReloadTimer = 0;
+    }
+    m_terminated = false;
+    m_sessionState = WKPageCopySessionState(m_page, 0, 0);
+
+    WKPageClose(m_page);
+    WKRelease(m_view);
+    m_view = 0;
+    m_page = 0;
+    m_browser->contextPool()->removeTab(m_context);
+    WKRelease(m_context);
+    m_context = 0;
+    // Until the page paints again after being restored.
+    m_needsDisplay = true;
+}
+
+bool Tab::restore(WKContextRef context)
+{
+    assert(isDiscarded());
+
+    m_context = context;
+    WKRetain(m_context);
+    init();
+    if (m_sessionState) {
+        WKPageRestoreFromSessionState(m_page, m_sessionState);
+        WKRelease(m_sessionState);
+        m_sessionState = 0;
+    } else if (!m_url.empty()) {
+        loadUrl(m_url);
+    } else
+        return false;
+    return true;
+}
+
 void Tab::onStartProgressCallback(WKPageRef, const void* clientInfo)
 {
     Tab* self = ((Tab*)clientInfo);
-    postToBundle(self->m_browser->ui(), "progressStarted", self->m_id);
+    self->m_browser->chrome()->progressStarted(self->m_id);
 }
 
 void Tab::onChangeProgressCallback(WKPageRef, const void* clientInfo)
 {
     Tab* self = ((Tab*)clientInfo);
-    postToBundle(self->m_browser->ui(), "progressChanged", self->m_id, WKPageGetEstimatedProgress(self->m_page));
+    self->m_browser->chrome()->progressChanged(self->m_id, WKPageGetEstimatedProgress(self->m_page));
 }
 
 void Tab::onFinishProgressCallback(WKPageRef, const void* clientInfo)
 {
     Tab* self = ((Tab*)clientInfo);
-    postToBundle(self->m_browser->ui(), "progressFinished", self->m_id);
+    self->m_browser->chrome()->progressFinished(self->m_id);
+    self->m_browser->tabLoadFinished(self);
 }
 
 void Tab::onCommitLoadForFrame(WKPageRef page, WKFrameRef frame, WKTypeRef, const void *clientInfo)
@@ -141,22 +238,91 @@ void Tab::onCommitLoadForFrame(WKPageRef page, WKFrameRef frame, WKTypeRef, cons
 
     WKURLRef url = WKPageCopyActiveURL(page);
     WKStringRef urlString = WKURLCopyString(url);
-    postToBundle(self->m_browser->ui(), "urlChanged", self->m_id, urlString);
+    self->m_url = fromWK<std::string>(urlString);
+    StartupTrace::mark(StartupTrace::FirstContentCommitted);
+    self->m_browser->tabUrlChanged(self);
+    self->m_browser->chrome()->urlChanged(self->m_id, self->m_url);
     WKRelease(url);
     WKRelease(urlString);
 }
 
-void Tab::onViewNeedsDisplayCallback(WKViewRef, WKRect, const void* clientInfo)
+void Tab::onViewNeedsDisplayCallback(WKViewRef, WKRect rect, const void* clientInfo)
 {
     Tab* self = ((Tab*)clientInfo);
-    // FIXME: Only do this is the tab is visible!
-    self->m_browser->scheduleUpdateDisplay();
+    if (!self->isVisible()) {
+        // The web process repaints the whole tab when it gets visible again.
+        self->m_needsDisplay = true;
+        ++self->m_suppressedDisplayRequests;
+        return;
+    }
+    self->m_needsDisplay = false;
+    self->m_browser->tabNeedsDisplay(self, rect);
 }
 
 void Tab::onWebProcessCrashedCallback(WKViewRef, WKURLRef, const void* clientInfo)
 {
-    const Tab* tab = reinterpret_cast<const Tab*>(clientInfo);
-    std::cerr << "Webprocess of tab " << tab->m_id << " crashed :-(" << std::endl;
+    Tab* self = ((Tab*)clientInfo);
+    if (self->m_terminated) {
+        self->m_terminated = false;
+        return;
+    }
+
+    std::cerr << "Webprocess of tab " << self->m_id << " crashed :-(" << std::endl;
+    self->m_browser->tabCrashed(self);
+    // Tabs sharing the process crash together, each one reloads itself.
+    self->scheduleReloadAfterCrash();
+}
+
+void Tab::terminateHungProcess()
+{
+    m_terminated = true;
+    WKPageTerminate(m_page);
+    m_browser->tabCrashed(this);
+    // Hangs count as crashes, so a page that hangs every time it loads is eventually left alone.
+    scheduleReloadAfterCrash();
+}
+
+void Tab::scheduleReloadAfterCrash()
+{
+    int delay = m_crashBackoff.crashed();
+    if (delay < 0) {
+        std::cerr << "Tab " << m_id << " crashed " << m_crashBackoff.crashes() << " times in a row, not reloading it" << std::endl;
+        m_browser->chrome()->tabCrashed(m_id);
+        return;
+    }
+    if (!m_crashReloadTimer)
+        m_crashReloadTimer = g_timeout_add(delay, reloadAfterCrashCallback, this);
+}
+
+gboolean Tab::reloadAfterCrashCallback(gpointer data)
+{
+    Tab* self = static_cast<Tab*>(data);
+    self->m_crashReloadTimer = 0;
+    // Crashes of the new process are real ones.
+    self->m_terminated = false;
+    // Loading on a page without process starts a new one.
+    if (self->m_url.empty())
+        WKPageReload(self->m_page);
+    else
+        self->loadUrl(self->m_url);
+    return false;
+}
+
+void Tab::onProcessDidBecomeUnresponsiveCallback(WKPageRef, const void* clientInfo)
+{
+    Tab* self = ((Tab*)clientInfo);
+    self->m_browser->tabUnresponsive(self);
+}
+
+void Tab::onProcessDidBecomeResponsiveCallback(WKPageRef, const void* clientInfo)
+{
+    Tab* self = ((Tab*)clientInfo);
+    self->m_browser->tabResponsive(self);
+}
+
+void Tab::ping()
+{
+    postToBundle(m_page, "ping", m_id);
 }
 
 void Tab::onReceiveTitleForFrame(WKPageRef page, WKStringRef title, WKFrameRef frame, WKTypeRef, const void* clientInfo)
@@ -166,23 +332,35 @@ void Tab::onReceiveTitleForFrame(WKPageRef page, WKStringRef title, WKFrameRef f
     if (page != self->m_page || !WKFrameIsMainFrame(frame))
         return;
 
-    postToBundle(self->m_browser->ui(), "titleChanged", self->m_id, title);
+    self->m_title = fromWK<std::string>(title);
+    self->m_browser->tabTitleChanged(self);
+    self->m_browser->chrome()->titleChanged(self->m_id, self->m_title);
 }
 
-void Tab::onFailProvisionalLoadWithErrorForFrameCallback(WKPageRef page, WKFrameRef frame, WKErrorRef error, WKTypeRef, const void*)
+void Tab::onFailProvisionalLoadWithErrorForFrameCallback(WKPageRef page, WKFrameRef frame, WKErrorRef error, WKTypeRef, const void* clientInfo)
 {
     if (!WKFrameIsMainFrame(frame))
         return;
 
+    Tab* self = ((Tab*)clientInfo);
+    self->m_browser->tabLoadFailed(self);
+
     WKStringRef wkErrorDescription = WKErrorCopyLocalizedDescription(error);
     WKPageLoadPlainTextString(page, wkErrorDescription);
     WKRelease(wkErrorDescription);
 }
 
-WKPageRef Tab::createNewPageCallback(WKPageRef, WKURLRequestRef, WKDictionaryRef, WKEventModifiers, WKEventMouseButton, const void* clientInfo)
+WKPageRef Tab::createNewPageCallback(WKPageRef, WKURLRequestRef request, WKDictionaryRef, WKEventModifiers, WKEventMouseButton, const void* clientInfo)
 {
     Tab* self = ((Tab*)clientInfo);
     Tab* newTab = self->m_browser->requestTab(self);
+    // No new tabs in kiosk mode, the popup is loaded here instead.
+    if (!newTab) {
+        WKURLRef url = WKURLRequestCopyURL(request);
+        WKPageLoadURL(self->m_page, url);
+        WKRelease(url);
+        return 0;
+    }
     WKRetain(newTab->m_page);
     return newTab->m_page;
 }
@@ -202,6 +380,11 @@ void Tab::onMouseDidMoveOverElement(WKPageRef, WKHitTestResultRef hitTestResult,
 
 void Tab::setSize(WKSize size)
 {
+    WKSize oldSize = WKViewGetSize(m_view);
+    if (oldSize.width == size.width && oldSize.height == size.height)
+        return;
+
+    m_browser->waitForPendingPaints();
     WKViewSetSize(m_view, size);
 }
 
@@ -224,11 +407,24 @@ void Tab::sendMouseEvent<NIXMouseEvent*>(NIXMouseEvent* event)
 
 void Tab::setViewportTranslation(int left, int top)
 {
+    WKPoint oldTranslation = WKViewGetUserViewportTranslation(m_view);
+    if (oldTranslation.x == left && oldTranslation.y == top)
+        return;
+
+    m_browser->waitForPendingPaints();
     WKViewSetUserViewportTranslation(m_view, left, top);
 }
 
 void Tab::setVisibility(WKPageVisibilityState state)
 {
+    if (state == m_visibility)
+        return;
+
+    if (isVisible())
+        m_lastVisibleTime = g_get_monotonic_time();
+    m_visibility = state;
+    m_browser->waitForPendingPaints();
+    WKViewSetIsVisible(m_view, isVisible());
     WKPageSetVisibilityState(m_page, state, false);
 }
 
@@ -28,16 +28,23 @@
 
 #include <string>
 #include <functional>
+#include <stdint.h>
+#include <sys/types.h>
+#include <string>
 #include <NIXView.h>
 #include <WebKit2/WKContext.h>
 #include <WebKit2/WKPageVisibilityTypes.h>
+#include <glib.h>
+#include "CrashBackoff.h"
 
 class Browser;
 
 class Tab {
 public:
-    Tab(Browser* browser);
+    Tab(Browser* browser, WKContextRef);
     Tab(Tab* parent);
+    // A discarded tab, for tabs of a previous session that are loaded once selected.
+    Tab(Browser* browser, const std::string& url, const std::string& title);
     ~Tab();
 
     int id() const { return m_id; }
@@ -51,6 +58,32 @@ public:
 
     void setViewportTranslation(int left, int top);
     void setVisibility(WKPageVisibilityState);
+    bool isVisible() const { return m_visibility == kWKPageVisibilityStateVisible; }
+    // True if the tab changed while hidden and no new frame arrived since it was shown.
+    bool needsDisplay() const { return m_needsDisplay; }
+
+    // Repaint requests ignored because the tab was hidden, since the tab was created. Logged by
+    // ResourceMonitor, background tabs that keep animating stand out there.
+    unsigned suppressedDisplayRequests() const { return m_suppressedDisplayRequests; }
+    // Monotonic time the tab was last hidden, or created if it was never shown.
+    int64_t lastVisibleTime() const { return m_lastVisibleTime; }
+
+    // Discarded tabs have no page nor web process, only their session to load them again.
+    bool isDiscarded() const { return !m_view; }
+    // The web process running the tab, 0 if discarded or not started.
+    pid_t processId() const;
+    void discard();
+    // Creates the page again in the given context and restores the session, which reloads it.
+    // False if there was nothing to load.
+    bool restore(WKContextRef);
+    // Of the last load committed on the main frame, also kept while discarded.
+    const std::string& url() const { return m_url; }
+    const std::string& title() const { return m_title; }
+
+    // Asks the injected bundle to answer with a pong, see HangMonitor.
+    void ping();
+    // Kills the web process of a hung tab, and reloads the tab like after a crash.
+    void terminateHungProcess();
 
     void loadUrl(const std::string& url);
     void back();
@@ -64,10 +97,29 @@ private:
     WKPageRef m_page;
     WKContextRef m_context;
 
+    WKPageVisibilityState m_visibility;
+    bool m_needsDisplay;
+    unsigned m_suppressedDisplayRequests;
+    int64_t m_lastVisibleTime;
+
+    // The back forward list with the scroll positions, kept while discarded.
+    WKDataRef m_sessionState;
+    std::string m_url;
+    std::string m_title;
+
+    CrashBackoff m_crashBackoff;
+    guint m_crashReloadTimer;
+    // The process was terminated on purpose, the reload is already scheduled.
+    bool m_terminated;
+
     void init();
+    void scheduleReloadAfterCrash();
+    static gboolean reloadAfterCrashCallback(gpointer);
 
     static void onViewNeedsDisplayCallback(WKViewRef, WKRect, const void* clientInfo);
     static void onWebProcessCrashedCallback(WKViewRef, WKURLRef, const void* clientInfo);
+    static void onProcessDidBecomeUnresponsiveCallback(WKPageRef, const void* clientInfo);
+    static void onProcessDidBecomeResponsiveCallback(WKPageRef, const void* clientInfo);
     static void onStartProgressCallback(WKPageRef, const void* clientInfo);
     static void onChangeProgressCallback(WKPageRef, const void* clientInfo);
     static void onFinishProgressCallback(WKPageRef, const void* clientInfo);
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TabThumbnailCache.h"
+
+#include "OffscreenBuffer.h"
+
+TabThumbnailCache::TabThumbnailCache(size_t maxBytes)
+    : m_bytes(0)
+    , m_maxBytes(maxBytes)
+    , m_useCounter(0)
+{
+}
+
+TabThumbnailCache::~TabThumbnailCache()
+{
+    for (std::pair<const int, Entry>& p : m_entries)
+        delete p.second.buffer;
+}
+
+OffscreenBuffer* TabThumbnailCache::store(int tabId, const WKSize& size)
+{
+    remove(tabId);
+
+    size_t bytes = size_t(size.width) * size.height * 4;
+    if (bytes > m_maxBytes)
+        return 0;
+    while (m_bytes + bytes > m_maxBytes)
+        evictLeastRecentlyUsed();
+
+    OffscreenBuffer* buffer = new OffscreenBuffer(OffscreenBuffer::ColorOnly);
+    if (!buffer->resize(size)) {
+        delete buffer;
+        return 0;
+    }
+
+    Entry entry = { buffer, bytes, ++m_useCounter };
+    m_entries[tabId] = entry;
+    m_bytes += bytes;
+    return buffer;
+}
+
+OffscreenBuffer* TabThumbnailCache::get(int tabId)
+{
+    auto it = m_entries.find(tabId);
+    if (it == m_entries.end())
+        return 0;
+    it->second.lastUse = ++m_useCounter;
+    return it->second.buffer;
+}
+
+void TabThumbnailCache::remove(int tabId)
+{
+    auto it = m_entries.find(tabId);
+    if (it == m_entries.end())
+        return;
+    m_bytes -= it->second.bytes;
+    delete it->second.buffer;
+    m_entries.erase(it);
+}
+
+void TabThumbnailCache::evictLeastRecentlyUsed()
+{
+    auto oldest = m_entries.begin();
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (it->second.lastUse < oldest->second.lastUse)
+            oldest = it;
+    }
+    remove(oldest->first);
+}
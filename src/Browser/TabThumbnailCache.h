@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TabThumbnailCache_h
+#define TabThumbnailCache_h
+
+#include <WebKit2/WKGeometry.h>
+#include <cstddef>
+#include <map>
+
+class OffscreenBuffer;
+
+// Downscaled copies of the last frame of background tabs, shown while a tab being switched to
+// repaints. Least recently used thumbnails are dropped to stay under the memory budget.
+// All methods must be called with the window GL context current.
+class TabThumbnailCache
+{
+public:
+    explicit TabThumbnailCache(size_t maxBytes);
+    ~TabThumbnailCache();
+
+    // Returns the buffer where the thumbnail of the tab must be painted, or 0 if it doesn't fit.
+    OffscreenBuffer* store(int tabId, const WKSize&);
+    // Returns the thumbnail of the tab, if any.
+    OffscreenBuffer* get(int tabId);
+    void remove(int tabId);
+
+    size_t bytes() const { return m_bytes; }
+
+private:
+    struct Entry {
+        OffscreenBuffer* buffer;
+        size_t bytes;
+        unsigned long long lastUse;
+    };
+
+    std::map<int, Entry> m_entries;
+    size_t m_bytes;
+    size_t m_maxBytes;
+    unsigned long long m_useCounter;
+
+    void evictLeastRecentlyUsed();
+};
+
+#endif
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "UiResources.h"
+
+#include "FatalError.h"
+#include <cstring>
+#include <glib.h>
+
+static const UiResource* findResource(const std::string& name)
+{
+    for (const UiResource* resource = uiResources; resource->name; ++resource) {
+        if (name == resource->name)
+            return resource;
+    }
+    return 0;
+}
+
+static std::string resourceText(const std::string& name)
+{
+    const UiResource* resource = findResource(name);
+    if (!resource)
+        throw FatalError("UI resource missing: " + name);
+    return std::string(reinterpret_cast<const char*>(resource->data), resource->size);
+}
+
+static void replaceAll(std::string& text, const std::string& from, const std::string& to)
+{
+    for (size_t position = text.find(from); position != std::string::npos; position = text.find(from, position + to.size()))
+        text.replace(position, from.size(), to);
+}
+
+// Replaces the tag having the given attribute, up to the end of the tag or to the closing tag
+// given, if any.
+static void replaceTag(std::string& html, const std::string& attribute, const std::string& closingTag, const std::string& replacement)
+{
+    size_t position = html.find(attribute);
+    if (position == std::string::npos)
+        return;
+    size_t start = html.rfind('<', position);
+    size_t end = closingTag.empty() ? html.find('>', position) : html.find(closingTag, position);
+    if (start == std::string::npos || end == std::string::npos)
+        return;
+    end += closingTag.empty() ? 1 : closingTag.size();
+    html.replace(start, end - start, replacement);
+}
+
+static void inlineImages(std::string& text)
+{
+    for (const UiResource* resource = uiResources; resource->name; ++resource) {
+        const char* extension = strrchr(resource->name, '.');
+        if (!extension || strcmp(extension, ".png"))
+            continue;
+
+        gchar* base64 = g_base64_encode(resource->data, resource->size);
+        std::string dataUri = std::string("data:image/png;base64,") + base64;
+        g_free(base64);
+        replaceAll(text, std::string("./") + resource->name, dataUri);
+        replaceAll(text, resource->name, dataUri);
+    }
+}
+
+std::string inlinedUiHtml()
+{
+    std::string html = resourceText("ui.html");
+    std::string css = resourceText("style.css");
+    inlineImages(css);
+    inlineImages(html);
+
+    replaceTag(html, "href=\"style.css\"", std::string(), "<style type=\"text/css\">\n" + css + "</style>");
+    for (const char* script : { "jquery-1.8.3.min.js", "jquery.hotkeys.js" }) {
+        std::string code = resourceText(script);
+        // A closing script tag inside the code would end the inline script early.
+        replaceAll(code, "</script", "<\\/script");
+        replaceTag(html, std::string("src=\"") + script + "\"", "</script>", "<script type=\"text/javascript\">\n" + code + "</script>");
+    }
+    return html;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "WebChrome.h"
+
+#include "Browser.h"
+#include "InjectedBundleGlue.h"
+
+WebChrome::WebChrome(Browser* browser)
+    : m_browser(browser)
+{
+}
+
+template<typename... T>
+void WebChrome::post(const char* message, const T&... values)
+{
+    if (m_browser->isUiReady())
+        postToBundle(m_browser->ui(), message, values...);
+}
+
+void WebChrome::tabAdded(int tabId, bool background)
+{
+    post("tabAdded", tabId, background ? 1 : 0);
+}
+
+void WebChrome::urlChanged(int tabId, const std::string& url)
+{
+    post("urlChanged", tabId, url);
+}
+
+void WebChrome::titleChanged(int tabId, const std::string& title)
+{
+    post("titleChanged", tabId, title);
+}
+
+void WebChrome::progressStarted(int tabId)
+{
+    post("progressStarted", tabId);
+}
+
+void WebChrome::progressChanged(int tabId, double progress)
+{
+    post("progressChanged", tabId, progress);
+}
+
+void WebChrome::progressFinished(int tabId)
+{
+    post("progressFinished", tabId);
+}
+
+void WebChrome::tabDiscarded(int tabId, bool discarded)
+{
+    post("tabDiscarded", tabId, discarded ? 1 : 0);
+}
+
+void WebChrome::tabCrashed(int tabId)
+{
+    post("tabCrashed", tabId);
+}
+
+void WebChrome::tabResourceUsage(int tabId, double cpuPercent, double pssMegabytes)
+{
+    post("tabResourceUsage", tabId, cpuPercent, pssMegabytes);
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WebChrome_h
+#define WebChrome_h
+
+#include "Chrome.h"
+
+class Browser;
+
+// The chrome of ui.html, running in its own web process. Everything is posted to the UI injected
+// bundle, which calls the functions of the same name on the page.
+class WebChrome : public Chrome
+{
+public:
+    WebChrome(Browser*);
+
+    virtual void tabAdded(int tabId, bool background);
+    virtual void urlChanged(int tabId, const std::string& url);
+    virtual void titleChanged(int tabId, const std::string& title);
+    virtual void progressStarted(int tabId);
+    virtual void progressChanged(int tabId, double progress);
+    virtual void progressFinished(int tabId);
+    virtual void tabDiscarded(int tabId, bool discarded);
+    virtual void tabCrashed(int tabId);
+    virtual void tabResourceUsage(int tabId, double cpuPercent, double pssMegabytes);
+
+private:
+    Browser* m_browser;
+
+    // Dropped while the UI page isn't ready, it gets the whole state once it is.
+    template<typename... T>
+    void post(const char* message, const T&... values);
+};
+
+#endif
@@ -0,0 +1,465 @@
+/*
+ * Copyright (C) 2012-2013 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "DesktopWindow.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <glib.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "FatalError.h"
+#include "StartupTrace.h"
+
+// DesktopWindow rendering to an EGL pbuffer, without any window system. Input comes from a script
+// file with one command per line:
+//
+//   move X Y              mouse move
+//   press X Y [BUTTON]    mouse press, BUTTON is left (default), middle or right
+//   release X Y [BUTTON]  mouse release
+//   click X Y [BUTTON]    mouse press followed by a release
+//   wheel X Y DELTA       vertical wheel, positive DELTA scrolls up
+//   type TEXT             key press and release for each character of the rest of the line
+//   key [ctrl+][shift+][alt+]NAME  NAME is a character, Return, Tab, Backspace, Escape, Left, Up,
+//                         Right, Down, PageUp, PageDown, Home, End or F1 to F12
+//   resize WIDTH HEIGHT
+//   expose
+//   hide                  as if the window was minimized
+//   show
+//   wait MILLISECONDS
+//   quit
+//
+// Lines starting with # are ignored.
+class DesktopWindowHeadless : public DesktopWindow {
+public:
+    DesktopWindowHeadless(DesktopWindowClient* client, int width, int height, const std::string& inputScript);
+    ~DesktopWindowHeadless();
+
+    void makeCurrent();
+    void doneCurrent();
+    void swapBuffers();
+    void setMouseCursor(MouseCursor) { }
+    void dispatchPendingEvents() { }
+    bool vsyncTiming(int64_t*, int64_t*) { return false; }
+    // Frames go as fast as they're painted, unless --max-fps is given.
+    bool hasDisplay() const { return false; }
+    // A pbuffer has a single buffer, so it always has the contents of the last frame.
+    int backBufferAge() { return 1; }
+    bool canCopySubBuffer() const { return false; }
+    void copySubBuffer(const WKRect&, const WKSize&) { }
+
+private:
+    void freeResources();
+    void setup();
+    void createSurface();
+    void loadInputScript(const std::string& path);
+    bool runInputScript();
+    void runCommand(const std::string& line);
+
+    static gboolean runInputScriptCallback(gpointer);
+
+    EGLDisplay m_display;
+    EGLConfig m_config;
+    EGLContext m_context;
+    EGLSurface m_surface;
+    WKSize m_surfaceSize;
+    // Resizes come from the input script on the main thread, but the surface is used on the render
+    // thread, so it's recreated there.
+    GMutex m_requestedSurfaceSizeMutex;
+    WKSize m_requestedSurfaceSize;
+
+    std::deque<std::string> m_inputScript;
+    guint m_inputScriptTimer;
+    int m_mouseX;
+    int m_mouseY;
+};
+
+DesktopWindow* DesktopWindow::createHeadless(DesktopWindowClient* client, int width, int height, const std::string& inputScript)
+{
+    return new DesktopWindowHeadless(client, width, height, inputScript);
+}
+
+DesktopWindowHeadless::DesktopWindowHeadless(DesktopWindowClient* client, int width, int height, const std::string& inputScript)
+    : DesktopWindow(client, width, height)
+    , m_display(EGL_NO_DISPLAY)
+    , m_config(0)
+    , m_context(EGL_NO_CONTEXT)
+    , m_surface(EGL_NO_SURFACE)
+    , m_surfaceSize(m_size)
+    , m_requestedSurfaceSize(m_size)
+    , m_inputScriptTimer(0)
+    , m_mouseX(0)
+    , m_mouseY(0)
+{
+    g_mutex_init(&m_requestedSurfaceSizeMutex);
+
+    try {
+        setup();
+        if (!inputScript.empty())
+            loadInputScript(inputScript);
+    } catch(const FatalError&) {
+        freeResources();
+        throw;
+    }
+
+    makeCurrent();
+    glEnable(GL_DEPTH_TEST);
+
+    if (!m_inputScript.empty())
+        m_inputScriptTimer = g_idle_add(runInputScriptCallback, this);
+}
+
+DesktopWindowHeadless::~DesktopWindowHeadless()
+{
+    if (m_inputScriptTimer)
+        g_source_remove(m_inputScriptTimer);
+    freeResources();
+    g_mutex_clear(&m_requestedSurfaceSizeMutex);
+}
+
+void DesktopWindowHeadless::freeResources()
+{
+    if (m_display == EGL_NO_DISPLAY)
+        return;
+
+    eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (m_surface != EGL_NO_SURFACE)
+        eglDestroySurface(m_display, m_surface);
+    if (m_context != EGL_NO_CONTEXT)
+        eglDestroyContext(m_display, m_context);
+    eglTerminate(m_display);
+}
+
+void DesktopWindowHeadless::setup()
+{
+    // Prefer Mesa's surfaceless platform, the default display may try to connect to a window system.
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (clientExtensions && strstr(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay)
+            m_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, 0);
+    }
+    if (m_display == EGL_NO_DISPLAY)
+        m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, 0, 0)) {
+        m_display = EGL_NO_DISPLAY;
+        throw FatalError("Couldn't initialize EGL");
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+        throw FatalError("EGL implementation doesn't support desktop OpenGL");
+
+    EGLint attributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_STENCIL_SIZE, 8,
+        EGL_NONE
+    };
+
+    EGLint numReturned = 0;
+    if (!eglChooseConfig(m_display, attributes, &m_config, 1, &numReturned) || !numReturned)
+        throw FatalError("No EGL pbuffer config available");
+
+    m_context = eglCreateContext(m_display, m_config, EGL_NO_CONTEXT, 0);
+    if (m_context == EGL_NO_CONTEXT)
+        throw FatalError("eglCreateContext() failed.");
+    StartupTrace::mark(StartupTrace::GLContextCreated);
+
+    createSurface();
+    StartupTrace::mark(StartupTrace::WindowSetUp);
+}
+
+void DesktopWindowHeadless::createSurface()
+{
+    if (m_surface != EGL_NO_SURFACE) {
+        eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroySurface(m_display, m_surface);
+    }
+
+    EGLint attributes[] = {
+        EGL_WIDTH, static_cast<EGLint>(m_surfaceSize.width),
+        EGL_HEIGHT, static_cast<EGLint>(m_surfaceSize.height),
+        EGL_NONE
+    };
+    m_surface = eglCreatePbufferSurface(m_display, m_config, attributes);
+    if (m_surface == EGL_NO_SURFACE)
+        throw FatalError("eglCreatePbufferSurface() failed.");
+}
+
+void DesktopWindowHeadless::makeCurrent()
+{
+    g_mutex_lock(&m_requestedSurfaceSizeMutex);
+    WKSize size = m_requestedSurfaceSize;
+    g_mutex_unlock(&m_requestedSurfaceSizeMutex);
+    if (size.width != m_surfaceSize.width || size.height != m_surfaceSize.height) {
+        m_surfaceSize = size;
+        try {
+            createSurface();
+        } catch (const FatalError& e) {
+            std::cerr << e.what() << std::endl;
+            return;
+        }
+    }
+
+    // The bound API is per thread.
+    eglBindAPI(EGL_OPENGL_API);
+    eglMakeCurrent(m_display, m_surface, m_surface, m_context);
+}
+
+void DesktopWindowHeadless::doneCurrent()
+{
+    eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+void DesktopWindowHeadless::swapBuffers()
+{
+    // There's nothing to present, wait for the GPU instead so frame timings stay meaningful and
+    // rendering doesn't queue up indefinitely.
+    glFinish();
+}
+
+void DesktopWindowHeadless::loadInputScript(const std::string& path)
+{
+    std::ifstream file(path.c_str());
+    if (!file)
+        throw FatalError("Can't open input script " + path);
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line[0] != '#')
+            m_inputScript.push_back(line);
+    }
+}
+
+gboolean DesktopWindowHeadless::runInputScriptCallback(gpointer data)
+{
+    DesktopWindowHeadless* self = reinterpret_cast<DesktopWindowHeadless*>(data);
+    self->m_inputScriptTimer = 0;
+    return self->runInputScript();
+}
+
+bool DesktopWindowHeadless::runInputScript()
+{
+    while (!m_inputScript.empty()) {
+        std::string line = m_inputScript.front();
+        m_inputScript.pop_front();
+
+        std::istringstream stream(line);
+        std::string command;
+        stream >> command;
+        if (command == "wait") {
+            unsigned milliseconds = 0;
+            stream >> milliseconds;
+            m_inputScriptTimer = g_timeout_add(milliseconds, runInputScriptCallback, this);
+            return false;
+        }
+        runCommand(line);
+    }
+    return false;
+}
+
+static WKEventMouseButton parseMouseButton(const std::string& name)
+{
+    if (name == "middle")
+        return kWKEventMouseButtonMiddleButton;
+    if (name == "right")
+        return kWKEventMouseButtonRightButton;
+    return kWKEventMouseButtonLeftButton;
+}
+
+static NIXMouseEvent createMouseEvent(NIXInputEventType type, int x, int y, WKEventMouseButton button, int clickCount)
+{
+    NIXMouseEvent ev;
+    memset(&ev, 0, sizeof(NIXMouseEvent));
+    ev.type = type;
+    ev.button = button;
+    ev.x = ev.globalX = x;
+    ev.y = ev.globalY = y;
+    ev.clickCount = clickCount;
+    ev.timestamp = g_get_monotonic_time() / double(G_USEC_PER_SEC);
+    return ev;
+}
+
+static bool parseKey(std::string name, NIXKeyEvent* ev, std::string* text)
+{
+    static const struct {
+        const char* name;
+        NIXKeyEventKey key;
+        const char* text;
+    } namedKeys[] = {
+        { "Return", kNIXKeyEventKey_Return, "\r" },
+        { "Tab", kNIXKeyEventKey_Tab, "\t" },
+        { "Backspace", kNIXKeyEventKey_Backspace, "\b" },
+        { "Escape", kNIXKeyEventKey_Escape, "" },
+        { "Left", kNIXKeyEventKey_Left, "" },
+        { "Up", kNIXKeyEventKey_Up, "" },
+        { "Right", kNIXKeyEventKey_Right, "" },
+        { "Down", kNIXKeyEventKey_Down, "" },
+        { "PageUp", kNIXKeyEventKey_PageUp, "" },
+        { "PageDown", kNIXKeyEventKey_PageDown, "" },
+        { "Home", kNIXKeyEventKey_Home, "" },
+        { "End", kNIXKeyEventKey_End, "" },
+    };
+
+    const struct {
+        const char* prefix;
+        uint32_t modifier;
+    } modifiers[] = {
+        { "ctrl+", kNIXInputEventModifiersControlKey },
+        { "shift+", kNIXInputEventModifiersShiftKey },
+        { "alt+", kNIXInputEventModifiersAltKey },
+    };
+    for (bool found = true; found;) {
+        found = false;
+        for (const auto& modifier : modifiers) {
+            size_t length = strlen(modifier.prefix);
+            if (name.length() > length && !name.compare(0, length, modifier.prefix)) {
+                ev->modifiers |= modifier.modifier;
+                name.erase(0, length);
+                found = true;
+            }
+        }
+    }
+
+    if (name.length() == 1 && isprint(name[0])) {
+        ev->key = static_cast<NIXKeyEventKey>(toupper(name[0]));
+        ev->shouldUseUpperCase = isupper(name[0]);
+        // Control combinations don't produce text.
+        if (!(ev->modifiers & kNIXInputEventModifiersControlKey))
+            *text = name;
+        return true;
+    }
+
+    if (name.length() > 1 && name[0] == 'F' && isdigit(name[1])) {
+        int number = atoi(name.c_str() + 1);
+        if (number < 1 || number > 12)
+            return false;
+        ev->key = static_cast<NIXKeyEventKey>(kNIXKeyEventKey_F1 + number - 1);
+        return true;
+    }
+
+    for (const auto& namedKey : namedKeys) {
+        if (name == namedKey.name) {
+            ev->key = namedKey.key;
+            *text = namedKey.text;
+            return true;
+        }
+    }
+    return false;
+}
+
+void DesktopWindowHeadless::runCommand(const std::string& line)
+{
+    std::istringstream stream(line);
+    std::string command;
+    stream >> command;
+
+    if (command == "move" || command == "press" || command == "release" || command == "click") {
+        std::string buttonName;
+        stream >> m_mouseX >> m_mouseY >> buttonName;
+        if (command == "move") {
+            NIXMouseEvent ev = createMouseEvent(kNIXInputEventTypeMouseMove, m_mouseX, m_mouseY, kWKEventMouseButtonNoButton, 0);
+            m_client->onMouseMove(&ev);
+            return;
+        }
+
+        WKEventMouseButton button = parseMouseButton(buttonName);
+        if (command != "release") {
+            NIXMouseEvent ev = createMouseEvent(kNIXInputEventTypeMouseDown, m_mouseX, m_mouseY, button, 1);
+            m_client->onMousePress(&ev);
+        }
+        if (command != "press") {
+            NIXMouseEvent ev = createMouseEvent(kNIXInputEventTypeMouseUp, m_mouseX, m_mouseY, button, 0);
+            m_client->onMouseRelease(&ev);
+        }
+    } else if (command == "wheel") {
+        NIXWheelEvent ev;
+        memset(&ev, 0, sizeof(NIXWheelEvent));
+        ev.type = kNIXInputEventTypeWheel;
+        stream >> m_mouseX >> m_mouseY >> ev.delta;
+        ev.x = ev.globalX = m_mouseX;
+        ev.y = ev.globalY = m_mouseY;
+        ev.orientation = kNIXWheelEventOrientationVertical;
+        ev.timestamp = g_get_monotonic_time() / double(G_USEC_PER_SEC);
+        m_client->onMouseWheel(&ev);
+    } else if (command == "type" || command == "key") {
+        std::string argument;
+        std::getline(stream >> std::ws, argument);
+        std::vector<std::string> keys;
+        if (command == "type") {
+            for (char c : argument)
+                keys.push_back(std::string(1, c));
+        } else
+            keys.push_back(argument);
+
+        for (const std::string& key : keys) {
+            NIXKeyEvent ev;
+            memset(&ev, 0, sizeof(NIXKeyEvent));
+            std::string text;
+            if (!parseKey(key, &ev, &text)) {
+                std::cerr << "Unknown key in input script: " << key << std::endl;
+                return;
+            }
+            ev.text = text.c_str();
+            ev.timestamp = g_get_monotonic_time() / double(G_USEC_PER_SEC);
+            ev.type = kNIXInputEventTypeKeyDown;
+            m_client->onKeyPress(&ev);
+            ev.type = kNIXInputEventTypeKeyUp;
+            m_client->onKeyRelease(&ev);
+        }
+    } else if (command == "resize") {
+        int width = 0;
+        int height = 0;
+        stream >> width >> height;
+        if (width <= 0 || height <= 0 || (width == m_size.width && height == m_size.height))
+            return;
+        m_size = WKSizeMake(width, height);
+        g_mutex_lock(&m_requestedSurfaceSizeMutex);
+        m_requestedSurfaceSize = m_size;
+        g_mutex_unlock(&m_requestedSurfaceSizeMutex);
+        m_client->onWindowSizeChange(m_size);
+    } else if (command == "expose")
+        m_client->onWindowExpose();
+    else if (command == "hide" || command == "show")
+        m_client->onWindowVisibilityChange(command == "show");
+    else if (command == "quit")
+        m_client->onWindowClose();
+    else
+        std::cerr << "Unknown input script command: " << line << std::endl;
+}
@@ -25,20 +25,101 @@
 
 #include "Browser.h"
 #include "FatalError.h"
+#include "StartupTrace.h"
 #include <iostream>
 #include <vector>
-#include <algorithm>
-#include <iterator>
+#include <cstdlib>
+#include <string>
 
 using namespace std;
 
+static bool parseIntOption(const string& arg, const char* name, int* value)
+{
+    const string prefix = string(name) + "=";
+    if (arg.compare(0, prefix.length(), prefix))
+        return false;
+
+    char* end;
+    const char* number = arg.c_str() + prefix.length();
+    long result = strtol(number, &end, 10);
+    if (!*number || *end || result < 0)
+        throw FatalError("Invalid value for " + string(name) + ": " + string(number));
+    *value = result;
+    return true;
+}
+
+static bool parseStringOption(const string& arg, const char* name, string* value)
+{
+    const string prefix = string(name) + "=";
+    if (arg.compare(0, prefix.length(), prefix))
+        return false;
+
+    *value = arg.substr(prefix.length());
+    if (value->empty())
+        throw FatalError("Missing value for " + string(name));
+    return true;
+}
+
+static bool parseFlagOption(const string& arg, const char* name, bool* value)
+{
+    if (arg != name)
+        return false;
+
+    *value = true;
+    return true;
+}
+
+static BrowserOptions parseOptions(int argc, const char** argv)
+{
+    BrowserOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const string arg(argv[i]);
+        if (arg.compare(0, 2, "--")) {
+            options.urls.push_back(arg);
+            continue;
+        }
+
+        if (parseIntOption(arg, "--max-fps", &options.maxFramesPerSecond)
+            || parseFlagOption(arg, "--perf-hud", &options.showPerformanceHud)
+            || parseStringOption(arg, "--frame-timings", &options.frameTimingsFile)
+            || parseFlagOption(arg, "--headless", &options.headless)
+            || parseStringOption(arg, "--input-script", &options.inputScript)
+            || parseStringOption(arg, "--batch", &options.batchOutputDirectory)
+            || parseIntOption(arg, "--batch-jobs", &options.batchJobs)
+            || parseIntOption(arg, "--batch-frames", &options.batchFrames)
+            || parseIntOption(arg, "--thumbnail-cache-mb", &options.thumbnailCacheMegabytes)
+            || parseIntOption(arg, "--idle-timeout", &options.idleTimeout)
+            || parseIntOption(arg, "--idle-fps", &options.idleFramesPerSecond)
+            || parseFlagOption(arg, "--idle-hide-tab", &options.hideTabWhenIdle)
+            || parseStringOption(arg, "--power-stats", &options.powerStatsFile)
+            || parseIntOption(arg, "--max-processes", &options.maxProcesses)
+            || parseFlagOption(arg, "--process-per-site", &options.processPerSite)
+            || parseFlagOption(arg, "--no-spare-tab", &options.disableSpareTab)
+            || parseIntOption(arg, "--tab-discard-mb", &options.tabDiscardThreshold)
+            || parseIntOption(arg, "--crash-retries", &options.crashRetries)
+            || parseStringOption(arg, "--session", &options.sessionFile)
+            || parseStringOption(arg, "--resource-log", &options.resourceLogFile)
+            || parseIntOption(arg, "--background-cpu", &options.backgroundCpuPercent)
+            || parseStringOption(arg, "--cgroup", &options.cgroup)
+            || parseIntOption(arg, "--max-loads", &options.maxLoads)
+            || parseStringOption(arg, "--startup-trace", &options.startupTraceFile)
+            || parseFlagOption(arg, "--native-chrome", &options.nativeChrome)
+            || parseFlagOption(arg, "--kiosk", &options.kiosk)
+            || parseIntOption(arg, "--hang-timeout", &options.hangTimeout))
+            continue;
+        throw FatalError("Unknown option: " + arg);
+    }
+
+    if (!options.inputScript.empty() && !options.headless)
+        throw FatalError("--input-script needs --headless");
+    return options;
+}
+
 int main(int argc, const char** argv)
 {
+    StartupTrace::mark(StartupTrace::MainEntered);
     try {
-        std::vector<std::string> args;
-        std::copy(&argv[1], &argv[argc], std::back_inserter(args));
-
-        Browser browser(args);
+        Browser browser(parseOptions(argc, argv));
         return browser.run();
     } catch (const FatalError& e) {
         cerr << e.what() << endl;
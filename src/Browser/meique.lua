@@ -1,15 +1,37 @@
 browser = Executable:new("drowser")
 browser:usePackage(glib)
+browser:usePackage(cairo)
 browser:usePackage(openGL)
 browser:usePackage(x11)
 browser:usePackage(nix)
+browser:usePackage(egl)
 
 browser:addFiles([[
   main.cpp
+  BatchRenderer.cpp
   Browser.cpp
+  ContextPool.cpp
+  CrashBackoff.cpp
+  DamageRegion.cpp
   DesktopWindow.cpp
+  FrameClock.cpp
+  FrameTimings.cpp
+  HangMonitor.cpp
   InjectedBundleGlue.cpp
+  LoadScheduler.cpp
+  MemoryPressureMonitor.cpp
+  NativeChrome.cpp
+  OffscreenBuffer.cpp
+  PerformanceHud.cpp
+  PowerMonitor.cpp
+  ProcessGroups.cpp
+  RenderThread.cpp
+  ResourceMonitor.cpp
+  SessionJournal.cpp
+  StartupTrace.cpp
   Tab.cpp
+  TabThumbnailCache.cpp
+  WebChrome.cpp
 
   ../Shared/WKConversions.cpp
 ]])
@@ -17,6 +39,7 @@ browser:addFiles([[
 UNIX:browser:addFiles([[
   x11/DesktopWindowLinux.cpp
   x11/XlibEventSource.cpp
+  headless/DesktopWindowHeadless.cpp
 ]])
 
 browser:addIncludePath("../Shared")
@@ -25,19 +25,27 @@
 
 #include "DesktopWindow.h"
 
+#include <cassert>
 #include <cstring>
 #include <GL/glx.h>
+#include <GL/glxext.h>
 #include <iostream>
+#include <sstream>
+#include <string>
 #include <X11/X.h>
 #include <X11/Xlib.h>
+#include <X11/Xatom.h>
 #include <X11/Xutil.h>
 #include <X11/cursorfont.h>
 
 #include "FatalError.h"
+#include "StartupTrace.h"
 #include "XlibEventSource.h"
 #include "XlibEventUtils.h"
 
 static Atom wmDeleteMessageAtom;
+static Atom netWmStateAtom;
+static Atom netWmStateHiddenAtom;
 static const double DOUBLE_CLICK_INTERVAL = 300;
 
 class ScopedXFree
@@ -52,16 +60,28 @@ private:
 
 class DesktopWindowLinux : public DesktopWindow, public XlibEventSource::Client {
 public:
-    DesktopWindowLinux(DesktopWindowClient* client, int width, int height);
+    DesktopWindowLinux(DesktopWindowClient* client, int width, int height, bool fullScreen);
     ~DesktopWindowLinux();
     void makeCurrent();
+    void doneCurrent();
     void swapBuffers();
     void setMouseCursor(MouseCursor cursor);
+    void dispatchPendingEvents();
+    bool vsyncTiming(int64_t* lastVBlank, int64_t* refreshInterval);
+    bool hasDisplay() const { return true; }
+    int backBufferAge();
+    bool canCopySubBuffer() const { return m_copySubBufferMESA; }
+    void copySubBuffer(const WKRect&, const WKSize& windowSize);
 private:
     void freeResources();
     void setup();
+    void setupGLXExtensions();
+    void setFullScreenProperties();
+    void sampleVideoSync();
     void destroyGLContext();
     void updateSizeIfNeeded(int width, int height);
+    void updateVisibility();
+    bool isMinimized();
 
     void sendKeyboardEventToNix(const XEvent& event);
     void handleXEvent(const XEvent&);
@@ -72,6 +92,7 @@ private:
     XlibEventSource* m_eventSource;
     Display* m_display;
     Window m_window;
+    bool m_fullScreen;
     XIM m_im;
     XIC m_ic;
     Cursor m_cursor;
@@ -82,18 +103,38 @@ private:
     int m_lastClickY;
     WKEventMouseButton m_lastClickButton;
     int m_clickCount;
+
+    // The window is visible when mapped, not fully obscured and not minimized.
+    bool m_mapped;
+    bool m_obscured;
+    bool m_minimized;
+    bool m_visible;
+
+    PFNGLXGETSYNCVALUESOMLPROC m_getSyncValuesOML;
+    PFNGLXGETMSCRATEOMLPROC m_getMscRateOML;
+    PFNGLXGETVIDEOSYNCSGIPROC m_getVideoSyncSGI;
+    // Sampled by the render thread, which has the context glXGetVideoSyncSGI needs.
+    GMutex m_videoSyncMutex;
+    unsigned int m_videoSyncCount;
+    unsigned int m_videoSyncBaseCount;
+    int64_t m_videoSyncBaseTime;
+    int64_t m_videoSyncTime;
+
+    bool m_hasBufferAge;
+    PFNGLXCOPYSUBBUFFERMESAPROC m_copySubBufferMESA;
 };
 
-DesktopWindow* DesktopWindow::create(DesktopWindowClient* client, int width, int height)
+DesktopWindow* DesktopWindow::create(DesktopWindowClient* client, int width, int height, bool fullScreen)
 {
-    return new DesktopWindowLinux(client, width, height);
+    return new DesktopWindowLinux(client, width, height, fullScreen);
 }
 
-DesktopWindowLinux::DesktopWindowLinux(DesktopWindowClient* client, int width, int height)
+DesktopWindowLinux::DesktopWindowLinux(DesktopWindowClient* client, int width, int height, bool fullScreen)
     : DesktopWindow(client, width, height)
     , m_eventSource(0)
     , m_display(0)
     , m_window(0)
+    , m_fullScreen(fullScreen)
     , m_im(0)
     , m_ic(0)
     , m_cursor(0)
@@ -103,7 +144,22 @@ DesktopWindowLinux::DesktopWindowLinux(DesktopWindowClient* client, int width, i
     , m_lastClickY(0)
     , m_lastClickButton(kWKEventMouseButtonNoButton)
     , m_clickCount(0)
+    , m_mapped(true)
+    , m_obscured(false)
+    , m_minimized(false)
+    , m_visible(true)
+    , m_getSyncValuesOML(0)
+    , m_getMscRateOML(0)
+    , m_getVideoSyncSGI(0)
+    , m_videoSyncCount(0)
+    , m_videoSyncBaseCount(0)
+    , m_videoSyncBaseTime(0)
+    , m_videoSyncTime(0)
+    , m_hasBufferAge(false)
+    , m_copySubBufferMESA(0)
 {
+    g_mutex_init(&m_videoSyncMutex);
+
     try {
         setup();
     } catch(const FatalError&) {
@@ -120,6 +176,7 @@ DesktopWindowLinux::DesktopWindowLinux(DesktopWindowClient* client, int width, i
 DesktopWindowLinux::~DesktopWindowLinux()
 {
     freeResources();
+    g_mutex_clear(&m_videoSyncMutex);
 }
 
 void DesktopWindowLinux::freeResources()
@@ -144,13 +201,138 @@ void DesktopWindowLinux::makeCurrent()
     glXMakeCurrent(m_display, m_window, m_context);
 }
 
+void DesktopWindowLinux::doneCurrent()
+{
+    glXMakeCurrent(m_display, None, 0);
+}
+
 void DesktopWindowLinux::swapBuffers()
 {
     glXSwapBuffers(m_display, m_window);
+    if (m_getVideoSyncSGI)
+        sampleVideoSync();
+}
+
+void DesktopWindowLinux::sampleVideoSync()
+{
+    // GLX_SGI_video_sync only gives a counter, so the vblank time is when we first see it change
+    // and the refresh interval is averaged over the counts seen so far.
+    unsigned int count;
+    if (m_getVideoSyncSGI(&count))
+        return;
+
+    int64_t now = g_get_monotonic_time();
+    g_mutex_lock(&m_videoSyncMutex);
+    if (!m_videoSyncBaseTime) {
+        m_videoSyncBaseCount = count;
+        m_videoSyncBaseTime = now;
+    }
+    if (count != m_videoSyncCount) {
+        m_videoSyncCount = count;
+        m_videoSyncTime = now;
+    }
+    g_mutex_unlock(&m_videoSyncMutex);
+}
+
+void DesktopWindowLinux::dispatchPendingEvents()
+{
+    m_eventSource->dispatchPendingEvents();
+}
+
+static bool hasGLXExtension(const char* extensions, const char* name)
+{
+    if (!extensions)
+        return false;
+
+    std::istringstream stream(extensions);
+    std::string extension;
+    while (stream >> extension) {
+        if (extension == name)
+            return true;
+    }
+    return false;
+}
+
+void DesktopWindowLinux::setupGLXExtensions()
+{
+    const char* extensions = glXQueryExtensionsString(m_display, DefaultScreen(m_display));
+
+    if (hasGLXExtension(extensions, "GLX_OML_sync_control")) {
+        m_getSyncValuesOML = reinterpret_cast<PFNGLXGETSYNCVALUESOMLPROC>(glXGetProcAddress(reinterpret_cast<const GLubyte*>("glXGetSyncValuesOML")));
+        m_getMscRateOML = reinterpret_cast<PFNGLXGETMSCRATEOMLPROC>(glXGetProcAddress(reinterpret_cast<const GLubyte*>("glXGetMscRateOML")));
+        if (!m_getSyncValuesOML || !m_getMscRateOML) {
+            m_getSyncValuesOML = 0;
+            m_getMscRateOML = 0;
+        }
+    }
+
+    if (!m_getSyncValuesOML && hasGLXExtension(extensions, "GLX_SGI_video_sync"))
+        m_getVideoSyncSGI = reinterpret_cast<PFNGLXGETVIDEOSYNCSGIPROC>(glXGetProcAddress(reinterpret_cast<const GLubyte*>("glXGetVideoSyncSGI")));
+
+    if (!m_getSyncValuesOML && !m_getVideoSyncSGI)
+        std::cerr << "No GLX vsync extension available, using a timer to pace frames.\n";
+
+    m_hasBufferAge = hasGLXExtension(extensions, "GLX_EXT_buffer_age");
+    if (hasGLXExtension(extensions, "GLX_MESA_copy_sub_buffer"))
+        m_copySubBufferMESA = reinterpret_cast<PFNGLXCOPYSUBBUFFERMESAPROC>(glXGetProcAddress(reinterpret_cast<const GLubyte*>("glXCopySubBufferMESA")));
+}
+
+int DesktopWindowLinux::backBufferAge()
+{
+    if (!m_hasBufferAge)
+        return -1;
+
+    unsigned int age = 0;
+    glXQueryDrawable(m_display, m_window, GLX_BACK_BUFFER_AGE_EXT, &age);
+    return age;
+}
+
+void DesktopWindowLinux::copySubBuffer(const WKRect& rect, const WKSize& windowSize)
+{
+    assert(m_copySubBufferMESA);
+    // GLX uses the lower left corner as origin.
+    int y = windowSize.height - rect.origin.y - rect.size.height;
+    m_copySubBufferMESA(m_display, m_window, rect.origin.x, y, rect.size.width, rect.size.height);
+}
+
+bool DesktopWindowLinux::vsyncTiming(int64_t* lastVBlank, int64_t* refreshInterval)
+{
+    if (m_getSyncValuesOML) {
+        // Mesa reports UST in microseconds of CLOCK_MONOTONIC, the same clock used by g_get_monotonic_time().
+        int64_t ust, msc, sbc;
+        int32_t numerator, denominator;
+        if (!m_getSyncValuesOML(m_display, m_window, &ust, &msc, &sbc) || !ust)
+            return false;
+        if (!m_getMscRateOML(m_display, m_window, &numerator, &denominator) || !numerator)
+            return false;
+        *lastVBlank = ust;
+        *refreshInterval = G_USEC_PER_SEC * int64_t(denominator) / numerator;
+        return true;
+    }
+
+    if (m_getVideoSyncSGI) {
+        // Swaps wait for the vblank, so the samples taken right after them are close enough.
+        const unsigned int minimumCountsForEstimate = 10;
+        g_mutex_lock(&m_videoSyncMutex);
+        unsigned int counts = m_videoSyncCount - m_videoSyncBaseCount;
+        bool hasEstimate = counts >= minimumCountsForEstimate;
+        if (hasEstimate) {
+            *lastVBlank = m_videoSyncTime;
+            *refreshInterval = (m_videoSyncTime - m_videoSyncBaseTime) / counts;
+        }
+        g_mutex_unlock(&m_videoSyncMutex);
+        return hasEstimate;
+    }
+
+    return false;
 }
 
 void DesktopWindowLinux::setup()
 {
+    // The render thread swaps buffers on the same connection the main thread reads events from,
+    // this must come before any other Xlib call.
+    XInitThreads();
+
     char* loc = setlocale(LC_ALL, "");
     if (!loc)
         std::cerr << "Could not use the the default environment locale.\n";
@@ -192,9 +374,16 @@ void DesktopWindowLinux::setup()
     if (!m_visualInfo)
         throw FatalError("No appropriate visual found.");
 
+    // The window manager would resize it anyway, starting at the right size saves a relayout.
+    if (m_fullScreen) {
+        int screen = DefaultScreen(m_display);
+        m_size = WKSizeMake(DisplayWidth(m_display, screen), DisplayHeight(m_display, screen));
+    }
+
     XSetWindowAttributes setAttributes;
     setAttributes.colormap = XCreateColormap(m_display, DefaultRootWindow(m_display), m_visualInfo->visual, AllocNone);
-    setAttributes.event_mask = ExposureMask | KeyPressMask | KeyReleaseMask | ButtonPressMask | ButtonReleaseMask | StructureNotifyMask | PointerMotionMask;
+    setAttributes.event_mask = ExposureMask | KeyPressMask | KeyReleaseMask | ButtonPressMask | ButtonReleaseMask | StructureNotifyMask | PointerMotionMask
+        | VisibilityChangeMask | PropertyChangeMask;
     m_window = XCreateWindow(m_display, DefaultRootWindow(m_display),
                                 0, 0, m_size.width, m_size.height, 0,
                                 m_visualInfo->depth, InputOutput, m_visualInfo->visual,
@@ -210,6 +399,10 @@ void DesktopWindowLinux::setup()
 
     wmDeleteMessageAtom = XInternAtom(m_display, "WM_DELETE_WINDOW", False);
     XSetWMProtocols(m_display, m_window, &wmDeleteMessageAtom, 1);
+    netWmStateAtom = XInternAtom(m_display, "_NET_WM_STATE", False);
+    netWmStateHiddenAtom = XInternAtom(m_display, "_NET_WM_STATE_HIDDEN", False);
+    if (m_fullScreen)
+        setFullScreenProperties();
 
     XMapWindow(m_display, m_window);
     XStoreName(m_display, m_window, "Drowser");
@@ -217,6 +410,22 @@ void DesktopWindowLinux::setup()
     m_context = glXCreateNewContext(m_display, fbConfig, GLX_RGBA_TYPE, NULL, GL_TRUE);
     if (!m_context)
         throw FatalError("glXCreateContext() failed.");
+    StartupTrace::mark(StartupTrace::GLContextCreated);
+
+    setupGLXExtensions();
+    StartupTrace::mark(StartupTrace::WindowSetUp);
+}
+
+void DesktopWindowLinux::setFullScreenProperties()
+{
+    // Set before mapping, so the window manager maps the window full screen right away.
+    Atom fullScreenState = XInternAtom(m_display, "_NET_WM_STATE_FULLSCREEN", False);
+    XChangeProperty(m_display, m_window, netWmStateAtom, XA_ATOM, 32, PropModeReplace, reinterpret_cast<unsigned char*>(&fullScreenState), 1);
+
+    // 1 asks compositing managers to unredirect the window, saving a copy of every frame.
+    long bypassCompositor = 1;
+    Atom bypassCompositorAtom = XInternAtom(m_display, "_NET_WM_BYPASS_COMPOSITOR", False);
+    XChangeProperty(m_display, m_window, bypassCompositorAtom, XA_CARDINAL, 32, PropModeReplace, reinterpret_cast<unsigned char*>(&bypassCompositor), 1);
 }
 
 void DesktopWindowLinux::destroyGLContext()
@@ -370,6 +579,23 @@ void DesktopWindowLinux::handleXEvent(const XEvent& event)
         if ((Atom)event.xclient.data.l[0] == wmDeleteMessageAtom)
             m_client->onWindowClose();
         break;
+    case MapNotify:
+    case UnmapNotify:
+        m_mapped = event.type == MapNotify;
+        updateVisibility();
+        break;
+    case VisibilityNotify:
+        // Compositing window managers redirect windows offscreen, so this only helps without them.
+        m_obscured = event.xvisibility.state == VisibilityFullyObscured;
+        updateVisibility();
+        break;
+    case PropertyNotify:
+        // Some window managers keep minimized windows mapped, but all of them set this state.
+        if (event.xproperty.atom == netWmStateAtom) {
+            m_minimized = isMinimized();
+            updateVisibility();
+        }
+        break;
     case MotionNotify: {
         NIXMouseEvent ev;
         const XPointerMovedEvent* xEvent = reinterpret_cast<const XPointerMovedEvent*>(&event);
@@ -415,6 +641,37 @@ void DesktopWindowLinux::updateSizeIfNeeded(int width, int height)
         m_client->onWindowSizeChange(m_size);
 }
 
+void DesktopWindowLinux::updateVisibility()
+{
+    bool visible = m_mapped && !m_obscured && !m_minimized;
+    if (visible == m_visible)
+        return;
+
+    m_visible = visible;
+    m_client->onWindowVisibilityChange(m_visible);
+}
+
+bool DesktopWindowLinux::isMinimized()
+{
+    Atom type;
+    int format;
+    unsigned long count;
+    unsigned long bytesAfter;
+    unsigned char* data = 0;
+    if (XGetWindowProperty(m_display, m_window, netWmStateAtom, 0, 1024, False, XA_ATOM, &type, &format, &count, &bytesAfter, &data) != Success || !data)
+        return false;
+
+    ScopedXFree x(data);
+    if (type != XA_ATOM || format != 32)
+        return false;
+    const Atom* states = reinterpret_cast<const Atom*>(data);
+    for (unsigned long i = 0; i < count; ++i) {
+        if (states[i] == netWmStateHiddenAtom)
+            return true;
+    }
+    return false;
+}
+
 void DesktopWindowLinux::setMouseCursor(MouseCursor cursor)
 {
     unsigned int x11Cursor;
@@ -51,13 +51,7 @@ static gboolean eventSourcePrepare(GSource* source, gint* timeout)
 static gboolean eventSourceDispatch(GSource* source, GSourceFunc callback, gpointer user_data)
 {
     WrappedGSource* wrappedSource = reinterpret_cast<WrappedGSource*>(source);
-    Display* display = wrappedSource->display();
-
-    do {
-        XEvent event;
-        XNextEvent(display, &event);
-        wrappedSource->client()->handleXEvent(event);
-    } while (XPending(display));
+    wrappedSource->xlibEventSource->dispatchPendingEvents();
 
     if (callback)
         callback(user_data);
@@ -96,3 +90,12 @@ XlibEventSource::~XlibEventSource()
     g_source_remove_poll(&m_source->source, &m_pollFD);
     g_source_destroy(&m_source->source);
 }
+
+void XlibEventSource::dispatchPendingEvents()
+{
+    while (XPending(m_display)) {
+        XEvent event;
+        XNextEvent(m_display, &event);
+        m_client->handleXEvent(event);
+    }
+}
@@ -43,6 +43,9 @@ public:
     XlibEventSource(Display*, Client*);
     ~XlibEventSource();
 
+    // Handles all events in the Xlib queue without waiting for the main loop to poll the connection.
+    void dispatchPendingEvents();
+
 private:
     friend struct WrappedGSource;
 
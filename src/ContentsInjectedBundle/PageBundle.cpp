@@ -26,6 +26,9 @@
 #include "PageBundle.h"
 #include "PlatformClient.h"
 
+#include <WebKit2/WKString.h>
+#include <cstring>
+
 // I don't care about windows or gcc < 4.x right now.
 #define UIBUNDLE_EXPORT __attribute__ ((visibility("default")))
 
@@ -42,11 +45,28 @@ UIBUNDLE_EXPORT void WKBundleInitialize(WKBundleRef bundle, WKTypeRef initializa
 PageBundle::PageBundle(WKBundleRef bundle)
     : m_bundle(bundle)
 {
-    m_platformClient = new PlatformClient();
+    m_platformClient = new PlatformClient(bundle);
     Nix::Platform::initialize(m_platformClient);
+
+    WKBundleClient client;
+    std::memset(&client, 0, sizeof(WKBundleClient));
+    client.version = kWKBundleClientCurrentVersion;
+    client.clientInfo = this;
+    client.didReceiveMessageToPage = &PageBundle::didReceiveMessageToPage;
+    WKBundleSetClient(bundle, &client);
 }
 
 PageBundle::~PageBundle()
 {
     delete m_platformClient;
 }
+
+void PageBundle::didReceiveMessageToPage(WKBundleRef bundle, WKBundlePageRef, WKStringRef name, WKTypeRef messageBody, const void*)
+{
+    // Answered from the main thread, so the browser doesn't hear back while a script is stuck.
+    if (WKStringIsEqualToUTF8CString(name, "ping")) {
+        WKStringRef pong = WKStringCreateWithUTF8CString("pong");
+        WKBundlePostMessage(bundle, pong, messageBody);
+        WKRelease(pong);
+    }
+}
@@ -36,6 +36,9 @@ public:
     PageBundle(WKBundleRef);
     ~PageBundle();
 
+    // Pings from the browser's HangMonitor.
+    static void didReceiveMessageToPage(WKBundleRef, WKBundlePageRef, WKStringRef name, WKTypeRef messageBody, const void*);
+
 private:
     WKBundleRef m_bundle;
     PlatformClient* m_platformClient;
@@ -4,7 +4,8 @@
 
 extern bool initializeAudioBackend();
 
-PlatformClient::PlatformClient()
+PlatformClient::PlatformClient(WKBundleRef bundle)
+    : m_bundle(bundle)
 {
     initializeAudioBackend();
     initializeGamepadController();
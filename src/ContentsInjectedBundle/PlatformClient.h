@@ -2,12 +2,13 @@
 #define PlatformClient_h
 
 #include <NixPlatform/Platform.h>
+#include <WebKit2/WKBundle.h>
 
 class GamepadController;
 
 class PlatformClient : public Nix::Platform {
 public:
-    PlatformClient();
+    PlatformClient(WKBundleRef);
 
     // Audio --------------------------------------------------------------
     virtual float audioHardwareSampleRate() { return 44100; }
@@ -34,6 +35,8 @@ public:
     virtual Nix::FFTFrame* createFFTFrame(unsigned fftsize);
     virtual Nix::FFTFrame* createFFTFrame(const Nix::FFTFrame* frame);
 private:
+    WKBundleRef m_bundle;
+
     // Gamepad
     void initializeGamepadController();
     GamepadController* m_gamepadController;
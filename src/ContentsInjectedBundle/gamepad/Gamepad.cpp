@@ -36,35 +36,37 @@
 
 class GamepadDevice {
 public:
-    static GamepadDevice* create(const char*, Nix::Gamepad*);
+    static GamepadDevice* create(const char*, Nix::Gamepad*, GamepadController*);
     ~GamepadDevice();
 
     void updateForEvent(struct js_event);
     Nix::Gamepad* device() { return m_nixGamepad; }
 
 private:
-    GamepadDevice(int, Nix::Gamepad*);
+    GamepadDevice(int, Nix::Gamepad*, GamepadController*);
     static gboolean readCallback(GObject* pollableStream, gpointer data);
 
     int m_fileDescriptor;
     Nix::Gamepad* m_nixGamepad;
+    GamepadController* m_controller;
     GInputStream* m_inputStream;
     GSource* m_source;
 };
 
-GamepadDevice* GamepadDevice::create(const char* deviceFile, Nix::Gamepad* gamepad)
+GamepadDevice* GamepadDevice::create(const char* deviceFile, Nix::Gamepad* gamepad, GamepadController* controller)
 {
     int fd = open(deviceFile, O_RDONLY | O_NONBLOCK);
 
     if (fd == -1)
         return 0;
 
-    return new GamepadDevice(fd, gamepad);
+    return new GamepadDevice(fd, gamepad, controller);
 }
 
-GamepadDevice::GamepadDevice(int fd, Nix::Gamepad* gamepad)
+GamepadDevice::GamepadDevice(int fd, Nix::Gamepad* gamepad, GamepadController* controller)
     : m_fileDescriptor(fd)
     , m_nixGamepad(gamepad)
+    , m_controller(controller)
     , m_inputStream(0)
     , m_source(0)
 {
@@ -172,12 +174,17 @@ void GamepadDevice::updateForEvent(struct js_event event)
         m_nixGamepad->buttons[event.number] = normalizeButtonValue(event.value);
 
     m_nixGamepad->timestamp = event.time;
+
+    if (!(event.type & JS_EVENT_INIT))
+        m_controller->deviceActivity();
 }
 
 //-------------- end of GamepadDevice
 
-GamepadController::GamepadController()
+GamepadController::GamepadController(const std::function<void()>& onActivity)
     : m_gamepadDevices(Nix::Gamepads::itemsLengthCap)
+    , m_onActivity(onActivity)
+    , m_lastActivityReport(0)
 {
     m_udev = udev_new();
     m_gamepadsMonitor = udev_monitor_new_from_netlink(m_udev, "udev");
@@ -217,16 +224,26 @@ GamepadController::~GamepadController()
     m_gamepadDevices.clear();
 }
 
-GamepadController* GamepadController::create()
+GamepadController* GamepadController::create(const std::function<void()>& onActivity)
 {
-    return new GamepadController();
+    return new GamepadController(onActivity);
+}
+
+void GamepadController::deviceActivity()
+{
+    // Axes send lots of events, the browser only needs to know someone is around.
+    int64_t now = g_get_monotonic_time();
+    if (!m_onActivity || now - m_lastActivityReport < G_USEC_PER_SEC)
+        return;
+    m_lastActivityReport = now;
+    m_onActivity();
 }
 
 void GamepadController::registerDevice(const char* deviceFile)
 {
     for (unsigned index = 0; index < m_gamepadDevices.size(); index++) {
         if (!m_gamepadDevices[index]) {
-            m_gamepadDevices[index] = GamepadDevice::create(deviceFile, &m_gamepads.items[index]);
+            m_gamepadDevices[index] = GamepadDevice::create(deviceFile, &m_gamepads.items[index], this);
             m_deviceMap.insert(std::make_pair(std::string(deviceFile), index));
             break;
         }
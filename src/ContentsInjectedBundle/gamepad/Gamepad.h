@@ -33,7 +33,9 @@ extern "C" {
 #include <gio/gunixinputstream.h>
 #include <NixPlatform/Platform.h>
 
+#include <functional>
 #include <map>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
@@ -41,13 +43,15 @@ class GamepadDevice;
 
 class GamepadController {
 public:
-    static GamepadController* create();
+    // onActivity is called when a gamepad is used, at most once per second.
+    static GamepadController* create(const std::function<void()>& onActivity);
     ~GamepadController();
 
     void sampleGamepads(Nix::Gamepads&);
+    void deviceActivity();
 
 private:
-    GamepadController();
+    GamepadController(const std::function<void()>& onActivity);
 
     void registerDevice(const char*);
     void unregisterDevice(const char*);
@@ -64,6 +68,9 @@ private:
 
     struct udev* m_udev;
     struct udev_monitor* m_gamepadsMonitor;
+
+    std::function<void()> m_onActivity;
+    int64_t m_lastActivityReport;
 };
 
 #endif // Gamepad_h
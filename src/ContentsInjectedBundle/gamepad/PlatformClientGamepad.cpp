@@ -1,11 +1,18 @@
 #include "PlatformClient.h"
 #include "Gamepad.h"
 
+#include <WebKit2/WKString.h>
 #include <cstdio>
 
 void PlatformClient::initializeGamepadController()
 {
-    m_gamepadController = GamepadController::create();
+    // Tells the browser someone is using it, see PowerMonitor.
+    WKBundleRef bundle = m_bundle;
+    m_gamepadController = GamepadController::create([bundle] {
+        WKStringRef name = WKStringCreateWithUTF8CString("gamepadActivity");
+        WKBundlePostMessage(bundle, name, 0);
+        WKRelease(name);
+    });
 }
 
 void PlatformClient::sampleGamepads(Nix::Gamepads& into)
@@ -100,6 +100,9 @@ void Bundle::didCreatePage(WKBundleRef, WKBundlePageRef page, const void* client
 
 void Bundle::didReceiveMessageToPage(WKBundleRef, WKBundlePageRef, WKStringRef name, WKTypeRef messageBody, const void*)
 {
+    // Messages sent before the window object is cleared have no script to call.
+    if (!gBundle->m_jsContext)
+        return;
     gBundle->callJSFunction(WKStringCopyJSString(name), gBundle->toJSVector(messageBody, ReverseOrder));
 }
 
@@ -133,6 +136,8 @@ void Bundle::registerJSFunction(const char* name)
 
 void Bundle::callJSFunction(JSStringRef name, const std::vector<JSValueRef>& args)
 {
+    if (!m_jsContext)
+        return;
     JSValueRef rawFunc = JSObjectGetProperty(m_jsContext, m_windowObj, name, 0);
     if (JSValueIsUndefined(m_jsContext, rawFunc)) {
         char buffer[64];
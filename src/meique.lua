@@ -1,5 +1,7 @@
 glib = findPackage("glib-2.0", REQUIRED)
+cairo = findPackage("cairo", REQUIRED)
 openGL = findPackage("gl", REQUIRED)
+egl = findPackage("egl", REQUIRED)
 x11 = findPackage("x11", REQUIRED)
 nix = findPackage("WebKitNix", REQUIRED)
 